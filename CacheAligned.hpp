@@ -0,0 +1,70 @@
+#ifndef SUMMEREX6_CACHEALIGNED_HPP
+#define SUMMEREX6_CACHEALIGNED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * a base for the types and members declared alignas(kCacheLine), so that no other data shares their cache line.
+ * before C++17 new ignores alignments beyond that of std::max_align_t, so the allocation functions of this class
+ * place every object and array of a derived type on a cache line boundary themselves.
+ */
+struct CacheAligned
+{
+    enum : size_t
+    {
+        kCacheLine = 64
+    };
+
+    static void* operator new(size_t size)
+    {
+        return _allocate(size);
+    }
+
+    static void* operator new[](size_t size)
+    {
+        return _allocate(size);
+    }
+
+    static void operator delete(void* block)
+    {
+        _free(block);
+    }
+
+    static void operator delete[](void* block)
+    {
+        _free(block);
+    }
+
+private:
+    /**
+     * allocate a block that starts on a cache line boundary, the address operator new returned is kept in the word
+     * before it.
+     * @param size - size of the block.
+     * @return - the block.
+     */
+    static void* _allocate(size_t size)
+    {
+        char* raw = static_cast<char*>(::operator new(size + sizeof(void*) + kCacheLine - 1));
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + kCacheLine - 1) &
+                            ~(uintptr_t) (kCacheLine - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /**
+     * free a block allocated by _allocate.
+     * @param block - the block, may be nullptr.
+     */
+    static void _free(void* block)
+    {
+        if (block != nullptr)
+        {
+            ::operator delete(static_cast<void**>(block)[-1]);
+        }
+    }
+};
+
+
+#endif //SUMMEREX6_CACHEALIGNED_HPP
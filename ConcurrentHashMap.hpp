@@ -0,0 +1,598 @@
+#ifndef SUMMEREX6_CONCURRENTHASHMAP_HPP
+#define SUMMEREX6_CONCURRENTHASHMAP_HPP
+
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "CacheAligned.hpp"
+#include "HashMap.hpp"
+#include "HashMix.hpp"
+
+/**
+ * a thread safe associative container. the keys are partitioned into segments by their hash code, every segment is
+ * a HashMap guarded by its own reader-writer lock and resizes on its own, so operations on different segments never
+ * wait for each other and lookups in the same segment run in parallel.
+ * values are returned by copy, since a reference could be invalidated by another thread as soon as the lock is
+ * released. snapshot() returns a point in time view that can be iterated while writers go on. every segment is
+ * split into parts of at most about kMaxPartSize elements, the number of parts growing with the segment, and the
+ * parts are shared with the snapshot and copied on write. so a write after a snapshot copies one small part, not
+ * its segment, and the copies the writers make add up to the parts they touched, not to the whole map.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class ConcurrentHashMap
+{
+private:
+    typedef HashMap<KeyT, ValueT, Hash, KeyEqual, true> SegmentMap;
+
+    typedef std::shared_lock<std::shared_timed_mutex> ReadLock;
+
+    typedef std::unique_lock<std::shared_timed_mutex> WriteLock;
+
+    typedef std::shared_ptr<SegmentMap> Part;
+
+    /**
+     * number of elements above which a part is split, by doubling the number of parts of its segment.
+     */
+    enum : size_t
+    {
+        kMaxPartSize = 1024
+    };
+
+    /**
+     * a part of the map along with its lock. the elements of the segment are spread over a power of two number of
+     * parts, each of which may be shared with snapshots, writers copy a part first in that case. the lock starts a
+     * cache line, and the segment fills whole cache lines, so the locks of neighbouring segments never share one.
+     */
+    struct Segment: public CacheAligned
+    {
+        alignas(CacheAligned::kCacheLine) mutable std::shared_timed_mutex lock;
+        std::vector<Part> parts;
+
+        Segment(const Hash& hash, const KeyEqual& keyEqual): parts(1, std::make_shared<SegmentMap>(hash, keyEqual))
+        {
+
+        }
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * the segments, their number is a power of two.
+     */
+    std::unique_ptr<std::unique_ptr<Segment>[]> _segments;
+
+    /**
+     * number of segments.
+     */
+    size_t _numOfSegments;
+
+    /**
+     * get the index of the part that holds a key, from the bits of the mixed hash code above those that select the
+     * segment.
+     * @param mixed - the mixed hash code of the key.
+     * @param numOfSegments - number of segments.
+     * @param numOfParts - number of parts of the segment.
+     * @return - index of the part in its segment.
+     */
+    static size_t _partIndex(size_t mixed, size_t numOfSegments, size_t numOfParts)
+    {
+        return (mixed / numOfSegments) & (numOfParts - 1);
+    }
+
+    /**
+     * get the segment of a mixed hash code. the segment is selected by the mixed hash code, so it is independent of
+     * the low bits the parts use to select a bucket.
+     * @param mixed - the mixed hash code of the key.
+     * @return - the segment that holds the key.
+     */
+    Segment& _segmentOf(size_t mixed) const
+    {
+        return *_segments[mixed & (_numOfSegments - 1)];
+    }
+
+    /**
+     * get the part of a segment that holds a key, the segment must be locked.
+     * @param segment - the segment of the key.
+     * @param mixed - the mixed hash code of the key.
+     * @return - the part.
+     */
+    Part& _partOf(Segment& segment, size_t mixed) const
+    {
+        return segment.parts[_partIndex(mixed, _numOfSegments, segment.parts.size())];
+    }
+
+    /**
+     * get a part for writing, copying it first if a snapshot shares it. its segment must be locked for writing, so
+     * no snapshot can start sharing the part meanwhile.
+     * @param part - the part.
+     * @return - the map of the part, owned by the segment alone.
+     */
+    static SegmentMap& _writable(Part& part)
+    {
+        if (part.use_count() > 1)
+        {
+            part = std::make_shared<SegmentMap>(*part);
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *part;
+    }
+
+    /**
+     * double the number of parts of a segment once one of them holds more than kMaxPartSize elements, so a copy on
+     * write stays small as the map grows. the elements are copied into new parts, the old ones are released or left
+     * to the snapshots that share them. the segment must be locked for writing.
+     * @param segment - the segment.
+     * @param part - the part that was just written.
+     */
+    void _splitIfLarge(Segment& segment, const Part& part)
+    {
+        if (part->size() <= kMaxPartSize)
+        {
+            return;
+        }
+        size_t numOfParts = segment.parts.size() * 2;
+        std::vector<Part> parts;
+        parts.reserve(numOfParts);
+        for (size_t i = 0; i < numOfParts; ++i)
+        {
+            parts.push_back(std::make_shared<SegmentMap>(_hasher, _keyEqual));
+        }
+        for (const Part& old : segment.parts)
+        {
+            for (const pair<KeyT, ValueT>& element : *old)
+            {
+                size_t mixed = mix_hash(_hasher(element.first));
+                parts[_partIndex(mixed, _numOfSegments, numOfParts)]->insert(element.first, element.second);
+            }
+        }
+        segment.parts.swap(parts);
+    }
+
+public:
+    /**
+     * a read only view of the map at the time it was taken. it holds the parts of the segments, so it stays valid
+     * and unchanged while the map is updated, and even after the map is destroyed.
+     */
+    class Snapshot
+    {
+    private:
+        friend class ConcurrentHashMap;
+
+        Hash _hasher;
+
+        /**
+         * the parts of all segments, segment after segment.
+         */
+        std::vector<std::shared_ptr<const SegmentMap>> _parts;
+
+        /**
+         * index in _parts of the first part of every segment, followed by the number of parts.
+         */
+        std::vector<size_t> _firstPart;
+
+        explicit Snapshot(const Hash& hash): _hasher(hash)
+        {
+
+        }
+
+        const SegmentMap& _mapOf(const KeyT& key) const
+        {
+            size_t mixed = mix_hash(_hasher(key));
+            size_t numOfSegments = _firstPart.size() - 1;
+            size_t segment = mixed & (numOfSegments - 1);
+            size_t numOfParts = _firstPart[segment + 1] - _firstPart[segment];
+            return *_parts[_firstPart[segment] + _partIndex(mixed, numOfSegments, numOfParts)];
+        }
+
+    public:
+        /**
+         * an iterator over the elements of a snapshot, part after part.
+         */
+        class const_iterator: public std::iterator<std::forward_iterator_tag, pair<KeyT, ValueT>>
+        {
+        private:
+            const Snapshot* _snapshot;
+            size_t _part;
+            typename SegmentMap::const_iterator _current;
+
+            /**
+             * move forward to the first element at or after the current position.
+             */
+            void _skipEmpty()
+            {
+                while (_part < _snapshot->_parts.size() && _current == _snapshot->_parts[_part]->end())
+                {
+                    _part++;
+                    if (_part < _snapshot->_parts.size())
+                    {
+                        _current = _snapshot->_parts[_part]->begin();
+                    }
+                }
+            }
+
+        public:
+            typedef const_iterator self_type;
+            typedef pair<KeyT, ValueT> value_type;
+            typedef const pair<KeyT, ValueT>& reference;
+            typedef const pair<KeyT, ValueT>* pointer;
+            typedef std::forward_iterator_tag iterator_category;
+            typedef int difference_type;
+
+            /**
+             * a constructor.
+             * @param snapshot - the snapshot to iterate.
+             * @param isEnd - true for an iterator past the last element, false for the first element.
+             */
+            const_iterator(const Snapshot* snapshot, bool isEnd): _snapshot(snapshot), _part(0)
+            {
+                if (isEnd || _snapshot->_parts.empty())
+                {
+                    _part = _snapshot->_parts.size();
+                    return;
+                }
+                _current = _snapshot->_parts[0]->begin();
+                _skipEmpty();
+            }
+
+            reference operator *() const
+            {
+                return *_current;
+            }
+
+            pointer operator ->() const
+            {
+                return &*_current;
+            }
+
+            self_type& operator ++()
+            {
+                ++_current;
+                _skipEmpty();
+                return *this;
+            }
+
+            self_type operator ++(int)
+            {
+                self_type toReturn = *this;
+                ++(*this);
+                return toReturn;
+            }
+
+            bool operator ==(const self_type& other) const
+            {
+                if (_part != other._part || _snapshot != other._snapshot)
+                {
+                    return false;
+                }
+                return _part == _snapshot->_parts.size() || _current == other._current;
+            }
+
+            bool operator !=(const self_type& other) const
+            {
+                return !(this->operator==(other));
+            }
+        };
+
+        typedef const_iterator iterator;
+
+        /**
+         * get the number of elements in the snapshot.
+         * @return - the number of elements.
+         */
+        size_t size() const
+        {
+            size_t total = 0;
+            for (const std::shared_ptr<const SegmentMap>& part : _parts)
+            {
+                total += part->size();
+            }
+            return total;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /**
+         * checks if the snapshot contains element with specific key
+         * @param key - key value of the element to search for.
+         * @return - true if there is such an element, otherwise false.
+         */
+        bool contains_key(const KeyT& key) const
+        {
+            return _mapOf(key).contains_key(key);
+        }
+
+        /**
+         * Returns a reference to the mapped value of the element with key equivalent to key. If no such element
+         * exists, an exception of type std::out_of_range is thrown.
+         * @param key - the key of the element to find.
+         * @return - Reference to the mapped value of the requested element.
+         */
+        const ValueT& at(const KeyT& key) const
+        {
+            return _mapOf(key).at(key);
+        }
+
+        iterator begin() const
+        {
+            return const_iterator(this, false);
+        }
+
+        const_iterator cbegin() const
+        {
+            return const_iterator(this, false);
+        }
+
+        iterator end() const
+        {
+            return const_iterator(this, true);
+        }
+
+        const_iterator cend() const
+        {
+            return const_iterator(this, true);
+        }
+    };
+
+    /**
+     * a constructor.
+     * @param concurrencyLevel - expected number of threads that update the map at once, rounded up to a power of two
+     * to get the number of segments.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit ConcurrentHashMap(size_t concurrencyLevel = 64, const Hash& hash = Hash(),
+                               const KeyEqual& keyEqual = KeyEqual()): _hasher(hash), _keyEqual(keyEqual),
+                                                                       _numOfSegments(1)
+    {
+        if (concurrencyLevel == 0)
+        {
+            throw std::invalid_argument("concurrency level must be positive.");
+        }
+        while (_numOfSegments < concurrencyLevel)
+        {
+            _numOfSegments *= 2;
+        }
+        _segments.reset(new std::unique_ptr<Segment>[_numOfSegments]);
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            _segments[i].reset(new Segment(hash, keyEqual));
+        }
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+
+    ConcurrentHashMap& operator =(const ConcurrentHashMap&) = delete;
+
+    /**
+     * get the number of segments.
+     * @return - the number of segments.
+     */
+    size_t segment_count() const
+    {
+        return _numOfSegments;
+    }
+
+    /**
+     * get the number of elements. the segments are counted one after the other, so the result may be stale under
+     * concurrent updates.
+     * @return - the number of elements.
+     */
+    size_t size() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            ReadLock guard(_segments[i]->lock);
+            for (const Part& part : _segments[i]->parts)
+            {
+                total += part->size();
+            }
+        }
+        return total;
+    }
+
+    /**
+     * check if the map is empty, with the same staleness as size().
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        WriteLock guard(segment.lock);
+        Part& part = _partOf(segment, mixed);
+        bool inserted = _writable(part).insert(key, value);
+        _splitIfLarge(segment, part);
+        return inserted;
+    }
+
+    /**
+     * Assigns value to the element with the given key, or inserts a new element if there is no such key.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the insertion took place, false if the assignment took place.
+     */
+    bool insert_or_assign(const KeyT& key, const ValueT& value)
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        WriteLock guard(segment.lock);
+        Part& part = _partOf(segment, mixed);
+        bool inserted = _writable(part).insert_or_assign(key, value);
+        _splitIfLarge(segment, part);
+        return inserted;
+    }
+
+    /**
+     * checks if the container contains element with specific key
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key) const
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        ReadLock guard(segment.lock);
+        return _partOf(segment, mixed)->contains_key(key);
+    }
+
+    /**
+     * Returns a copy of the value mapped to key. If no such element exists, an exception of type std::out_of_range is
+     * thrown.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the requested element.
+     */
+    ValueT at(const KeyT& key) const
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        ReadLock guard(segment.lock);
+        return _partOf(segment, mixed)->at(key);
+    }
+
+    /**
+     * copy the value mapped to key, if there is one.
+     * @param key - the key of the element to find.
+     * @param value - set to the mapped value if the key was found.
+     * @return - true if the key was found, false otherwise.
+     */
+    bool find(const KeyT& key, ValueT& value) const
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        ReadLock guard(segment.lock);
+        const SegmentMap& map = *_partOf(segment, mixed);
+        auto it = map.find(key);
+        if (it == map.end())
+        {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        WriteLock guard(segment.lock);
+        return _writable(_partOf(segment, mixed)).erase(key);
+    }
+
+    /**
+     * call a function on the value mapped to key while the segment is locked for writing, inserting a default
+     * value if the key is not in the map yet.
+     * @tparam Function - type of the function, callable with ValueT&.
+     * @param key - the key of the element to update.
+     * @param function - the function to call, it must not access the map.
+     */
+    template<typename Function>
+    void update(const KeyT& key, Function function)
+    {
+        size_t mixed = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(mixed);
+        WriteLock guard(segment.lock);
+        Part& part = _partOf(segment, mixed);
+        function(_writable(part)[key]);
+        _splitIfLarge(segment, part);
+    }
+
+    /**
+     * call a function on every element. every segment is locked for reading while its elements are visited, so the
+     * elements of one segment are seen consistently but updates of other segments may or may not be seen.
+     * @tparam Function - type of the function, callable with const pair<KeyT, ValueT>&.
+     * @param function - the function to call, it must not access the map.
+     */
+    template<typename Function>
+    void for_each(Function function) const
+    {
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            ReadLock guard(_segments[i]->lock);
+            for (const Part& part : _segments[i]->parts)
+            {
+                for (const pair<KeyT, ValueT>& element : *part)
+                {
+                    function(element);
+                }
+            }
+        }
+    }
+
+    /**
+     * take a point in time view of the map. all segments are locked for reading at once while their parts are
+     * shared with the snapshot, which takes time proportional to the number of parts, about size() / kMaxPartSize
+     * plus the number of segments, and copies no element.
+     * @return - the snapshot.
+     */
+    Snapshot snapshot() const
+    {
+        Snapshot result(_hasher);
+        result._firstPart.reserve(_numOfSegments + 1);
+        std::vector<ReadLock> guards;
+        guards.reserve(_numOfSegments);
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            guards.emplace_back(_segments[i]->lock);
+            result._firstPart.push_back(result._parts.size());
+            result._parts.insert(result._parts.end(), _segments[i]->parts.begin(), _segments[i]->parts.end());
+        }
+        result._firstPart.push_back(result._parts.size());
+        return result;
+    }
+
+    /**
+     * Erases all elements from the container, one segment after the other.
+     */
+    void clear()
+    {
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            WriteLock guard(_segments[i]->lock);
+            _segments[i]->parts.assign(1, std::make_shared<SegmentMap>(_hasher, _keyEqual));
+        }
+    }
+};
+
+
+#endif //SUMMEREX6_CONCURRENTHASHMAP_HPP
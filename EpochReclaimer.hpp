@@ -0,0 +1,248 @@
+#ifndef SUMMEREX6_EPOCHRECLAIMER_HPP
+#define SUMMEREX6_EPOCHRECLAIMER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include "CacheAligned.hpp"
+#include "ThreadIndex.hpp"
+
+/**
+ * epoch based reclamation of memory that lock free readers may still be looking at.
+ * a reader enters a critical section by publishing the current epoch in a slot of its own, so reading writes no
+ * cache line that other threads write. a writer unlinks an object, retires it with the epoch it was unlinked in and
+ * advances the epoch, and the object is freed once every reader that is still inside a critical section entered
+ * after that epoch.
+ * retiring never blocks: retired objects are pushed on a lock free stack, and the thread that retires an object
+ * frees what it can only if no other thread is doing so.
+ * up to kMaxThreads threads may use the reclaimers of a process at once.
+ */
+class EpochReclaimer
+{
+public:
+    enum : size_t
+    {
+        kMaxThreads = ThreadIndex::kMaxThreads
+    };
+
+private:
+    /**
+     * the epoch a thread entered its critical section in, 0 while it is outside of one. every slot fills a cache line
+     * of its own, so the slots of different threads never share one.
+     */
+    struct alignas(CacheAligned::kCacheLine) Slot: public CacheAligned
+    {
+        std::atomic<uint64_t> epoch;
+        size_t depth;
+
+        Slot(): epoch(0), depth(0)
+        {
+
+        }
+    };
+
+    /**
+     * an object waiting to be freed.
+     */
+    struct Retired
+    {
+        uint64_t epoch;
+        void* object;
+        void (*deleter)(void*);
+        Retired* next;
+    };
+
+    std::atomic<uint64_t> _epoch;
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<Retired*> _incoming;
+    std::mutex _retiredLock;
+    std::vector<Retired> _retired;
+
+    /**
+     * get the slot of the calling thread.
+     * @return - the slot.
+     */
+    Slot& _slot()
+    {
+        return _slots[ThreadIndex::current()];
+    }
+
+    /**
+     * move the objects retired since the last call from _incoming to _retired. _retiredLock must be held.
+     */
+    void _drain()
+    {
+        Retired* retired = _incoming.exchange(nullptr, std::memory_order_acquire);
+        while (retired != nullptr)
+        {
+            Retired* next = retired->next;
+            _retired.push_back(*retired);
+            delete retired;
+            retired = next;
+        }
+    }
+
+    /**
+     * free the retired objects no reader can see anymore. _retiredLock must be held.
+     */
+    void _reclaim()
+    {
+        _drain();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldest = UINT64_MAX;
+        for (size_t i = 0; i < kMaxThreads; ++i)
+        {
+            uint64_t entered = _slots[i].epoch.load(std::memory_order_acquire);
+            if (entered != 0 && entered < oldest)
+            {
+                oldest = entered;
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < _retired.size(); ++i)
+        {
+            if (_retired[i].epoch < oldest)
+            {
+                _retired[i].deleter(_retired[i].object);
+            }
+            else
+            {
+                _retired[kept++] = _retired[i];
+            }
+        }
+        _retired.resize(kept);
+    }
+
+public:
+    /**
+     * keeps the calling thread inside a critical section while it exists, critical sections may be nested.
+     */
+    class Guard
+    {
+    private:
+        EpochReclaimer* _reclaimer;
+
+    public:
+        explicit Guard(EpochReclaimer& reclaimer): _reclaimer(&reclaimer)
+        {
+            _reclaimer->enter();
+        }
+
+        Guard(const Guard&) = delete;
+
+        Guard& operator =(const Guard&) = delete;
+
+        ~Guard()
+        {
+            _reclaimer->leave();
+        }
+    };
+
+    EpochReclaimer(): _epoch(1), _slots(new Slot[kMaxThreads]), _incoming(nullptr)
+    {
+
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+
+    EpochReclaimer& operator =(const EpochReclaimer&) = delete;
+
+    /**
+     * frees all retired objects, no reader may be inside a critical section.
+     */
+    ~EpochReclaimer()
+    {
+        _drain();
+        for (const Retired& retired : _retired)
+        {
+            retired.deleter(retired.object);
+        }
+    }
+
+    /**
+     * enter a critical section, objects read from now on are not freed until leave is called.
+     */
+    void enter()
+    {
+        Slot& slot = _slot();
+        if (slot.depth++ == 0)
+        {
+            slot.epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    /**
+     * leave a critical section.
+     */
+    void leave()
+    {
+        Slot& slot = _slot();
+        if (--slot.depth == 0)
+        {
+            slot.epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    /**
+     * free an object once no reader can see it anymore. it must already be unreachable for readers that enter from
+     * now on.
+     * @param object - the object to free.
+     * @param deleter - function that frees the object.
+     */
+    void retire(void* object, void (*deleter)(void*))
+    {
+        uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+        Retired* retired = new Retired{epoch, object, deleter, _incoming.load(std::memory_order_relaxed)};
+        while (!_incoming.compare_exchange_weak(retired->next, retired, std::memory_order_release,
+                                                std::memory_order_relaxed))
+        {
+
+        }
+        if (_retiredLock.try_lock())
+        {
+            std::lock_guard<std::mutex> guard(_retiredLock, std::adopt_lock);
+            _reclaim();
+        }
+    }
+
+    /**
+     * free an object allocated with new once no reader can see it anymore.
+     * @tparam T - type of the object.
+     * @param object - the object to free, may be nullptr.
+     */
+    template<typename T>
+    void retire(T* object)
+    {
+        if (object != nullptr)
+        {
+            retire(object, [](void* p) { delete static_cast<T*>(p); });
+        }
+    }
+
+    /**
+     * free the retired objects no reader can see anymore, without retiring a new one.
+     */
+    void reclaim()
+    {
+        std::lock_guard<std::mutex> guard(_retiredLock);
+        _reclaim();
+    }
+
+    /**
+     * get the number of objects waiting to be freed.
+     * @return - the number of retired objects.
+     */
+    size_t pending()
+    {
+        std::lock_guard<std::mutex> guard(_retiredLock);
+        _drain();
+        return _retired.size();
+    }
+};
+
+
+#endif //SUMMEREX6_EPOCHRECLAIMER_HPP
@@ -0,0 +1,406 @@
+#ifndef SUMMEREX6_FLATCOMBININGHASHMAP_HPP
+#define SUMMEREX6_FLATCOMBININGHASHMAP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "CacheAligned.hpp"
+#include "HashMap.hpp"
+#include "ThreadIndex.hpp"
+
+/**
+ * a thread safe associative container for update streams that hit a few keys very often.
+ * a thread does not touch the map itself: it posts its operation in a slot of its own and waits. whichever waiting
+ * thread gets the combiner role collects all posted operations, groups them by key and applies every group with a
+ * single lookup, so a hot key is found once per batch instead of once per operation, and the map and its buckets
+ * stay in the cache of one core.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class FlatCombiningHashMap
+{
+private:
+    typedef HashMap<KeyT, ValueT, Hash, KeyEqual, true> Map;
+
+    enum : int
+    {
+        kIdle,
+        kPending,
+        kDone
+    };
+
+    /**
+     * kinds of operations.
+     */
+    enum Kind
+    {
+        kRead,
+        kUpdate,
+        kInsert,
+        kAssign,
+        kErase
+    };
+
+    /**
+     * number of times the combiner scans the slots before it gives up its role.
+     */
+    enum : size_t
+    {
+        kCombinePasses = 3
+    };
+
+    /**
+     * an operation posted by a thread. kRead and kUpdate call apply with the value of the key and context, kInsert
+     * and kAssign copy the value context points to. every request fills a cache line of its own, so posting one
+     * writes no line that another thread polls.
+     */
+    struct alignas(CacheAligned::kCacheLine) Request: public CacheAligned
+    {
+        std::atomic<int> state;
+        Kind kind;
+        const KeyT* key;
+        size_t hash;
+        void (*apply)(ValueT&, void*);
+        void* context;
+        bool result;
+        std::exception_ptr error;
+
+        Request(): state(kIdle)
+        {
+
+        }
+    };
+
+    Map _map;
+
+    /**
+     * hash function of the keys, to group the operations of a batch.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * one slot per thread index.
+     */
+    std::unique_ptr<Request[]> _requests;
+
+    /**
+     * number of slots that were ever used, the combiner scans no further.
+     */
+    std::atomic<size_t> _usedSlots;
+
+    /**
+     * whether some thread holds the combiner role.
+     */
+    std::atomic<bool> _combining;
+
+    /**
+     * number of elements, updated by the combiner after every batch.
+     */
+    std::atomic<size_t> _size;
+
+    /**
+     * find the value of a key.
+     * @param key - the key.
+     * @return - pointer to the value, nullptr if the key is not in the map.
+     */
+    ValueT* _lookup(const KeyT& key)
+    {
+        auto it = _map.find(key);
+        return it == _map.end() ? nullptr : const_cast<ValueT*>(&it->second);
+    }
+
+    /**
+     * apply the operations of one key in the order they were collected, with a single lookup unless one of them
+     * inserts or erases.
+     * @param batch - the collected operations.
+     * @param begin - first operation of the key.
+     * @param end - past the last operation of the key.
+     */
+    void _applyGroup(std::vector<Request*>& batch, size_t begin, size_t end)
+    {
+        const KeyT& key = *batch[begin]->key;
+        ValueT* value = _lookup(key);
+        for (size_t i = begin; i < end; ++i)
+        {
+            Request& request = *batch[i];
+            try
+            {
+                switch (request.kind)
+                {
+                    case kRead:
+                        request.result = value != nullptr;
+                        if (value != nullptr)
+                        {
+                            request.apply(*value, request.context);
+                        }
+                        break;
+                    case kUpdate:
+                        if (value == nullptr)
+                        {
+                            value = &_map[key];
+                        }
+                        request.apply(*value, request.context);
+                        request.result = true;
+                        break;
+                    case kInsert:
+                    case kAssign:
+                        request.result = value == nullptr;
+                        if (value == nullptr)
+                        {
+                            value = &_map[key];
+                            *value = *static_cast<const ValueT*>(request.context);
+                        }
+                        else if (request.kind == kAssign)
+                        {
+                            *value = *static_cast<const ValueT*>(request.context);
+                        }
+                        break;
+                    case kErase:
+                        request.result = value != nullptr && _map.erase(key);
+                        value = nullptr;
+                        break;
+                }
+            }
+            catch (...)
+            {
+                request.error = std::current_exception();
+            }
+        }
+    }
+
+    /**
+     * collect the posted operations, apply them grouped by key, and mark them done.
+     * @param batch - storage for the collected operations.
+     * @return - the number of operations applied.
+     */
+    size_t _combineBatch(std::vector<Request*>& batch)
+    {
+        batch.clear();
+        size_t used = _usedSlots.load(std::memory_order_acquire);
+        for (size_t i = 0; i < used; ++i)
+        {
+            if (_requests[i].state.load(std::memory_order_acquire) == kPending)
+            {
+                batch.push_back(&_requests[i]);
+            }
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const Request* a, const Request* b)
+        {
+            return a->hash < b->hash;
+        });
+        size_t begin = 0;
+        while (begin < batch.size())
+        {
+            size_t end = begin + 1;
+            while (end < batch.size() && batch[end]->hash == batch[begin]->hash)
+            {
+                end++;
+            }
+            const KeyT* key = batch[begin]->key;
+            auto split = std::stable_partition(batch.begin() + begin + 1, batch.begin() + end,
+                                               [this, key](const Request* request)
+            {
+                return _keyEqual(*request->key, *key);
+            });
+            end = split - batch.begin();
+            _applyGroup(batch, begin, end);
+            begin = end;
+        }
+        _size.store(_map.size(), std::memory_order_relaxed);
+        for (Request* request : batch)
+        {
+            request->state.store(kDone, std::memory_order_release);
+        }
+        return batch.size();
+    }
+
+    /**
+     * post an operation and wait until some combiner, possibly this thread, applied it.
+     * @param kind - kind of the operation.
+     * @param key - the key.
+     * @param apply - function called with the value, for kRead and kUpdate.
+     * @param context - argument of apply, or the value of kInsert and kAssign.
+     * @return - the result of the operation.
+     */
+    bool _execute(Kind kind, const KeyT& key, void (*apply)(ValueT&, void*), void* context)
+    {
+        size_t index = ThreadIndex::current();
+        size_t used = _usedSlots.load(std::memory_order_relaxed);
+        while (used <= index && !_usedSlots.compare_exchange_weak(used, index + 1))
+        {
+
+        }
+        Request& request = _requests[index];
+        request.kind = kind;
+        request.key = &key;
+        request.hash = _hasher(key);
+        request.apply = apply;
+        request.context = context;
+        request.error = nullptr;
+        request.state.store(kPending, std::memory_order_release);
+        std::vector<Request*> batch;
+        while (request.state.load(std::memory_order_acquire) != kDone)
+        {
+            if (!_combining.load(std::memory_order_relaxed) && !_combining.exchange(true, std::memory_order_acquire))
+            {
+                for (size_t pass = 0; pass < kCombinePasses; ++pass)
+                {
+                    if (_combineBatch(batch) == 0)
+                    {
+                        break;
+                    }
+                }
+                _combining.store(false, std::memory_order_release);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        request.state.store(kIdle, std::memory_order_relaxed);
+        if (request.error)
+        {
+            std::rethrow_exception(request.error);
+        }
+        return request.result;
+    }
+
+public:
+    /**
+     * a constructor.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit FlatCombiningHashMap(const Hash& hash = Hash(), const KeyEqual& keyEqual = KeyEqual()):
+            _map(hash, keyEqual), _hasher(hash), _keyEqual(keyEqual), _requests(new Request[ThreadIndex::kMaxThreads]),
+            _usedSlots(0), _combining(false), _size(0)
+    {
+
+    }
+
+    FlatCombiningHashMap(const FlatCombiningHashMap&) = delete;
+
+    FlatCombiningHashMap& operator =(const FlatCombiningHashMap&) = delete;
+
+    /**
+     * get the number of elements after the last applied batch.
+     * @return - the number of elements.
+     */
+    size_t size() const
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * check if the map is empty.
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        return _execute(kInsert, key, nullptr, const_cast<ValueT*>(&value));
+    }
+
+    /**
+     * Assigns value to the element with the given key, or inserts a new element if there is no such key.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the insertion took place, false if the assignment took place.
+     */
+    bool insert_or_assign(const KeyT& key, const ValueT& value)
+    {
+        return _execute(kAssign, key, nullptr, const_cast<ValueT*>(&value));
+    }
+
+    /**
+     * call a function on the value mapped to key, inserting a default value if the key is not in the map yet. this
+     * is the combined form of operator[] followed by a change of the value.
+     * @tparam Function - type of the function, callable with ValueT&.
+     * @param key - the key of the element to update.
+     * @param function - the function to call, it runs on the combiner thread and must not access the map.
+     */
+    template<typename Function>
+    void update(const KeyT& key, Function function)
+    {
+        _execute(kUpdate, key, [](ValueT& value, void* context)
+        {
+            (*static_cast<Function*>(context))(value);
+        }, &function);
+    }
+
+    /**
+     * copy the value mapped to key, if there is one.
+     * @param key - the key of the element to find.
+     * @param value - set to the mapped value if the key was found.
+     * @return - true if the key was found, false otherwise.
+     */
+    bool find(const KeyT& key, ValueT& value)
+    {
+        return _execute(kRead, key, [](ValueT& found, void* context)
+        {
+            *static_cast<ValueT*>(context) = found;
+        }, &value);
+    }
+
+    /**
+     * Returns a copy of the value mapped to key. If no such element exists, an exception of type std::out_of_range is
+     * thrown.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the requested element.
+     */
+    ValueT at(const KeyT& key)
+    {
+        ValueT value;
+        if (!find(key, value))
+        {
+            throw std::out_of_range("Hash map does not contain the given key.");
+        }
+        return value;
+    }
+
+    /**
+     * checks if the container contains element with specific key
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key)
+    {
+        return _execute(kRead, key, [](ValueT&, void*) {}, nullptr);
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        return _execute(kErase, key, nullptr, nullptr);
+    }
+};
+
+
+#endif //SUMMEREX6_FLATCOMBININGHASHMAP_HPP
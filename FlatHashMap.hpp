@@ -0,0 +1,876 @@
+#ifndef SUMMEREX6_FLATHASHMAP_HPP
+#define SUMMEREX6_FLATHASHMAP_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include "GroupMatch.hpp"
+#include "HashMix.hpp"
+#include "Prefetch.hpp"
+using std::pair;
+
+/**
+ * an open-addressing associative container in the style of swiss tables. elements live in one flat slot array, and
+ * a separate array of control bytes holds a 7-bit tag of every element's hash, so a probe reads a group of control
+ * bytes and only touches the slots whose tag matches. a group is matched with SIMD compares, see GroupMatch.
+ * it is a container of its own, not a backend of HashMap, and offers only the core of the interface of HashMap: size,
+ * capacity, empty, insert, contains_key, at, operator[], erase, contains_many, at_many, load_factor, clear,
+ * iteration, copying and comparison. code that uses only these can switch between the two by type.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys. its results are always passed through mix_hash, since the probe uses
+ * their low bits for the tag and their high bits for the position.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class FlatHashMap
+{
+private:
+    typedef signed char ctrl_t;
+
+    /**
+     * control byte values. a full slot holds its 7-bit tag (0..127), every other state is negative.
+     */
+    enum : ctrl_t
+    {
+        kEmpty = -128,
+        kDeleted = -2
+    };
+
+    /**
+     * number of control bytes matched by one probe step, the smallest capacity of the table, and the number of keys
+     * a batched lookup prefetches at once.
+     */
+    enum : size_t
+    {
+        kGroupWidth = GroupMatch::kWidth,
+        kMinCapacity = GroupMatch::kWidth,
+        kLookupGroup = 16
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * control bytes. holds capacity() bytes followed by a copy of the first kGroupWidth - 1 bytes, so a group that
+     * starts near the end of the table can be read without wrapping.
+     */
+    ctrl_t* _ctrl = nullptr;
+
+    /**
+     * the slot array. a slot is constructed only while its control byte is full.
+     */
+    pair<KeyT, ValueT>* _slots = nullptr;
+
+    /**
+     * number of slots in the table, always a power of two.
+     */
+    size_t _capacity{};
+
+    /**
+     * number of elements the map currently holds.
+     */
+    size_t _size{};
+
+    /**
+     * number of empty slots that can still be filled before the table has to be rebuilt.
+     */
+    size_t _growthLeft{};
+
+    /**
+     * get the mixed hash code of a key.
+     * @param key - key to hash.
+     * @return - hash code.
+     */
+    size_t _hash(const KeyT& key) const
+    {
+        return mix_hash(_hasher(key));
+    }
+
+    /**
+     * get the 7-bit tag stored in the control byte of an element.
+     * @param hash - hash code of the element.
+     * @return - the tag.
+     */
+    static ctrl_t _tag(size_t hash)
+    {
+        return (ctrl_t) (hash & 0x7F);
+    }
+
+    /**
+     * get the slot a probe for the given hash starts from.
+     * @param hash - hash code of the element.
+     * @return - index of the first probed slot.
+     */
+    size_t _home(size_t hash) const
+    {
+        return (hash >> 7) & (_capacity - 1);
+    }
+
+    /**
+     * get the maximum number of elements a table of the given capacity may hold (a load factor of 7/8).
+     * @param capacity - capacity of the table.
+     * @return - maximum number of elements.
+     */
+    static size_t _maxElements(size_t capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    /**
+     * get the index of the lowest set bit of a non zero mask.
+     * @param mask - the mask.
+     * @return - index of the lowest set bit.
+     */
+    static size_t _lowestBit(uint32_t mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(mask);
+#else
+        size_t i = 0;
+        while (!(mask & 1u))
+        {
+            mask >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
+
+    /**
+     * match a group of control bytes against a tag.
+     * @param group - first control byte of the group.
+     * @param tag - tag to look for.
+     * @return - a mask with bit i set if group[i] equals tag.
+     */
+    static uint32_t _matchTag(const ctrl_t* group, ctrl_t tag)
+    {
+        return GroupMatch::match(group, tag);
+    }
+
+    /**
+     * match the empty control bytes of a group.
+     * @param group - first control byte of the group.
+     * @return - a mask with bit i set if group[i] is empty.
+     */
+    static uint32_t _matchEmpty(const ctrl_t* group)
+    {
+        return _matchTag(group, kEmpty);
+    }
+
+    /**
+     * match the control bytes of a group that can receive a new element.
+     * @param group - first control byte of the group.
+     * @return - a mask with bit i set if group[i] is empty or deleted.
+     */
+    static uint32_t _matchFree(const ctrl_t* group)
+    {
+        return GroupMatch::match_negative(group);
+    }
+
+    /**
+     * set a control byte, and its copy after the end of the table.
+     * @param index - index of the slot.
+     * @param value - new control byte.
+     */
+    void _setCtrl(size_t index, ctrl_t value)
+    {
+        _ctrl[index] = value;
+        if (index < kGroupWidth - 1)
+        {
+            _ctrl[_capacity + index] = value;
+        }
+    }
+
+    /**
+     * allocate an empty table.
+     * @param capacity - number of slots, a power of two of at least kMinCapacity.
+     */
+    void _allocate(size_t capacity)
+    {
+        _ctrl = new ctrl_t[capacity + kGroupWidth - 1];
+        std::memset(_ctrl, kEmpty, capacity + kGroupWidth - 1);
+        _slots = std::allocator<pair<KeyT, ValueT>>().allocate(capacity);
+        _capacity = capacity;
+        _growthLeft = _maxElements(capacity) - _size;
+    }
+
+    /**
+     * destroy all elements and free the table.
+     */
+    void _free()
+    {
+        if (_ctrl == nullptr)
+        {
+            return;
+        }
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_ctrl[i] >= 0)
+            {
+                _slots[i].~pair();
+            }
+        }
+        std::allocator<pair<KeyT, ValueT>>().deallocate(_slots, _capacity);
+        delete [] _ctrl;
+        _ctrl = nullptr;
+        _slots = nullptr;
+    }
+
+    /**
+     * find the slot of a key.
+     * @param key - key to look for.
+     * @param hash - hash code of the key.
+     * @return - index of the slot holding key, or capacity() if there is no such slot.
+     */
+    size_t _find(const KeyT& key, size_t hash) const
+    {
+        const size_t mask = _capacity - 1;
+        const ctrl_t tag = _tag(hash);
+        size_t pos = _home(hash);
+        for (size_t probed = 0; probed < _capacity; probed += kGroupWidth)
+        {
+            const ctrl_t* group = _ctrl + pos;
+            for (uint32_t match = _matchTag(group, tag); match != 0; match &= match - 1)
+            {
+                size_t index = (pos + _lowestBit(match)) & mask;
+                if (_keyEqual(_slots[index].first, key))
+                {
+                    return index;
+                }
+            }
+            if (_matchEmpty(group) != 0)
+            {
+                break;
+            }
+            pos = (pos + kGroupWidth) & mask;
+        }
+        return _capacity;
+    }
+
+    /**
+     * look up a sequence of keys in groups. every key of a group is hashed and the control bytes and the slot its
+     * probe starts from are prefetched, and only then are the keys looked up.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam Visitor - type of the visitor, callable with the index of the slot of a key, or capacity() if the key
+     * is not in the map.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param visit - called once for every key, in order.
+     */
+    template<typename ForwardIterator, typename Visitor>
+    void _lookupMany(ForwardIterator keysBegin, ForwardIterator keysEnd, Visitor& visit) const
+    {
+        const KeyT* keys[kLookupGroup];
+        size_t hashes[kLookupGroup];
+        while (keysBegin != keysEnd)
+        {
+            size_t count = 0;
+            for (; keysBegin != keysEnd && count < kLookupGroup; ++keysBegin, ++count)
+            {
+                keys[count] = std::addressof(*keysBegin);
+                hashes[count] = _hash(*keys[count]);
+                prefetch_read(_ctrl + _home(hashes[count]));
+                prefetch_read(_slots + _home(hashes[count]));
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                visit(_find(*keys[i], hashes[i]));
+            }
+        }
+    }
+
+    /**
+     * find the first slot a new element with the given hash can be placed in.
+     * @param hash - hash code of the element.
+     * @return - index of an empty or deleted slot.
+     */
+    size_t _findFree(size_t hash) const
+    {
+        const size_t mask = _capacity - 1;
+        size_t pos = _home(hash);
+        while (true)
+        {
+            uint32_t match = _matchFree(_ctrl + pos);
+            if (match != 0)
+            {
+                return (pos + _lowestBit(match)) & mask;
+            }
+            pos = (pos + kGroupWidth) & mask;
+        }
+    }
+
+    /**
+     * rebuild the table with a new capacity, dropping all deleted markers.
+     * @param capacity - the new capacity.
+     */
+    void _resize(size_t capacity)
+    {
+        ctrl_t* oldCtrl = _ctrl;
+        pair<KeyT, ValueT>* oldSlots = _slots;
+        size_t oldCapacity = _capacity;
+        _allocate(capacity);
+        for (size_t i = 0; i < oldCapacity; ++i)
+        {
+            if (oldCtrl[i] >= 0)
+            {
+                size_t hash = _hash(oldSlots[i].first);
+                size_t index = _findFree(hash);
+                new (_slots + index) pair<KeyT, ValueT>(std::move(oldSlots[i]));
+                _setCtrl(index, _tag(hash));
+                oldSlots[i].~pair();
+            }
+        }
+        std::allocator<pair<KeyT, ValueT>>().deallocate(oldSlots, oldCapacity);
+        delete [] oldCtrl;
+    }
+
+    /**
+     * find a slot for a new element, rebuilding the table first if it has no room left.
+     * @param hash - hash code of the element.
+     * @return - index of the slot to construct the element in.
+     */
+    size_t _prepareInsert(size_t hash)
+    {
+        size_t index = _findFree(hash);
+        if (_growthLeft == 0 && _ctrl[index] == kEmpty)
+        {
+            // a table full of deleted markers is cleaned in place, a full one is doubled.
+            _resize(_size <= _maxElements(_capacity) / 2 ? _capacity : _capacity * 2);
+            index = _findFree(hash);
+        }
+        return index;
+    }
+
+    /**
+     * mark a slot that was returned by _prepareInsert and has been constructed as full.
+     * @param index - index of the slot.
+     * @param hash - hash code of the element.
+     */
+    void _commitInsert(size_t index, size_t hash)
+    {
+        if (_ctrl[index] == kEmpty)
+        {
+            _growthLeft--;
+        }
+        _setCtrl(index, _tag(hash));
+        _size++;
+    }
+
+    /**
+     * destroy the element in a full slot. the slot becomes empty again if no probe could have passed over it, which
+     * is the case when the run of non empty slots around it is shorter than a group.
+     * @param index - index of the slot.
+     */
+    void _eraseAt(size_t index)
+    {
+        _slots[index].~pair();
+        _size--;
+        const size_t indexBefore = (index - kGroupWidth) & (_capacity - 1);
+        const uint32_t emptyAfter = _matchEmpty(_ctrl + index);
+        const uint32_t emptyBefore = _matchEmpty(_ctrl + indexBefore);
+        if (emptyAfter != 0 && emptyBefore != 0)
+        {
+            size_t fullAfter = _lowestBit(emptyAfter);
+            size_t fullBefore = 0;
+            for (uint32_t bit = 1u << (kGroupWidth - 1); !(emptyBefore & bit); bit >>= 1)
+            {
+                fullBefore++;
+            }
+            if (fullAfter + fullBefore < kGroupWidth)
+            {
+                _setCtrl(index, kEmpty);
+                _growthLeft++;
+                return;
+            }
+        }
+        _setCtrl(index, kDeleted);
+    }
+
+public:
+
+    /**
+     * an iterator for the map.
+     */
+    class const_iterator: public std::iterator<std::forward_iterator_tag, pair<KeyT, ValueT>>
+    {
+    private:
+        const FlatHashMap* _map;
+        size_t _index;
+
+        /**
+         * move forward to the first full slot at or after the current one.
+         */
+        void _skipFree()
+        {
+            while (_index < _map->_capacity && _map->_ctrl[_index] < 0)
+            {
+                _index++;
+            }
+        }
+
+    public:
+        typedef const_iterator self_type;
+        typedef pair<KeyT, ValueT> value_type;
+        typedef const pair<KeyT, ValueT>& reference;
+        typedef const pair<KeyT, ValueT>* pointer;
+        typedef std::forward_iterator_tag iterator_category;
+        typedef int difference_type;
+
+        /**
+         * default constructor.
+         */
+        const_iterator(): _map(nullptr), _index(0)
+        {
+
+        }
+
+        /**
+         * a constructor to construct from a map and a slot.
+         * @param map - map to iterate.
+         * @param index - first slot to consider, the iterator moves to the first full slot from it on.
+         */
+        const_iterator(const FlatHashMap* map, size_t index): _map(map), _index(index)
+        {
+            _skipFree();
+        }
+
+        /**
+         * dereference operator.
+         * @return - pair<KeyT, ValueT>.
+         */
+        reference operator *() const
+        {
+            return _map->_slots[_index];
+        }
+
+        /**
+         * pointer operator.
+         * @return - pointer to the current pair.
+         */
+        pointer operator ->() const
+        {
+            return _map->_slots + _index;
+        }
+
+        /**
+         * forwarding operator.
+         * @return - self after moving.
+         */
+        self_type& operator ++()
+        {
+            _index++;
+            _skipFree();
+            return *this;
+        }
+
+        /**
+         * forwarding operator.
+         * @return - a copy of self before moving.
+         */
+        self_type operator ++(int)
+        {
+            self_type toReturn = *this;
+            ++(*this);
+            return toReturn;
+        }
+
+        /**
+         * compare to other iterator.
+         * @param other - other iterator for comparison.
+         * @return - true if equal, false else.
+         */
+        bool operator ==(const self_type& other) const
+        {
+            return _index == other._index && _map == other._map;
+        }
+
+        /**
+         * compare to other iterator.
+         * @param other - other iterator for comparison.
+         * @return - true if different, false else.
+         */
+        bool operator !=(const self_type& other) const
+        {
+            return !(this->operator==(other));
+        }
+    };
+
+    typedef const_iterator iterator;
+
+    /**
+     * a default constructor.
+     */
+    FlatHashMap(): FlatHashMap(Hash())
+    {
+
+    }
+
+    /**
+     * a constructor with given hash and key equality functions.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit FlatHashMap(const Hash& hash, const KeyEqual& keyEqual = KeyEqual()): _hasher(hash), _keyEqual(keyEqual)
+    {
+        _allocate(kMinCapacity);
+    }
+
+    /**
+     * a copy constructor.
+     * @param other - other map to copy from.
+     */
+    FlatHashMap(const FlatHashMap& other): _hasher(other._hasher), _keyEqual(other._keyEqual), _size(other._size)
+    {
+        _allocate(other._capacity);
+        std::memcpy(_ctrl, other._ctrl, _capacity + kGroupWidth - 1);
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_ctrl[i] >= 0)
+            {
+                new (_slots + i) pair<KeyT, ValueT>(other._slots[i]);
+            }
+        }
+        _growthLeft = other._growthLeft;
+    }
+
+    /**
+     * gets 2 iterators for keys and values and stores them in the map.
+     * @tparam KeysInputIterator - iterator to keys.
+     * @tparam ValuesInputIterator - iterator to values.
+     * @param keysBegin - beginning of keys vector.
+     * @param keysEnd - end of keys vector.
+     * @param valuesBegin - beginning of values vector.
+     * @param valuesEnd - end of values vector.
+     */
+    template<typename KeysInputIterator, typename ValuesInputIterator>
+    FlatHashMap(KeysInputIterator keysBegin, KeysInputIterator keysEnd, ValuesInputIterator valuesBegin,
+                ValuesInputIterator valuesEnd): FlatHashMap()
+    {
+        if (std::distance(keysBegin, keysEnd) != std::distance(valuesBegin, valuesEnd))
+        {
+            throw std::length_error("given vectors are of different size.");
+        }
+        for (; keysBegin != keysEnd; ++keysBegin, ++valuesBegin)
+        {
+            this->operator[](*keysBegin) = *valuesBegin;
+        }
+    }
+
+    /**
+     * deletes and frees the map.
+     */
+    ~FlatHashMap()
+    {
+        _free();
+    }
+
+    /**
+     * get the number of elements the map currently contains.
+     * @return - the number of elements the map currently contains.
+     */
+    size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * get the capacity of the map.
+     * @return - the capacity.
+     */
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * check if the map is empty.
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        size_t hash = _hash(key);
+        if (_find(key, hash) != _capacity)
+        {
+            return false;
+        }
+        size_t index = _prepareInsert(hash);
+        new (_slots + index) pair<KeyT, ValueT>(key, value);
+        _commitInsert(index, hash);
+        return true;
+    }
+
+    /**
+     * checks if the container contains element with specific key
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key) const
+    {
+        return _find(key, _hash(key)) != _capacity;
+    }
+
+    /**
+     * Returns a reference to the mapped value of the element with key equivalent to key. If no such element exists,
+     * an exception of type std::out_of_range is thrown.
+     * @param key - the key of the element to find.
+     * @return - Reference to the mapped value of the requested element.
+     */
+    ValueT& at(const KeyT& key)
+    {
+        size_t index = _find(key, _hash(key));
+        if (index == _capacity)
+        {
+            throw std::out_of_range("Hash map does not contain given key.");
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * Returns a const reference to the mapped value of the element with key equivalent to key. If no such element
+     * exists, an exception of type std::out_of_range is thrown.
+     * @param key - the key of the element to find.
+     * @return - Reference to the mapped value of the requested element.
+     */
+    const ValueT& at(const KeyT& key) const
+    {
+        size_t index = _find(key, _hash(key));
+        if (index == _capacity)
+        {
+            throw std::out_of_range("Hash map does not contain the given key.");
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * checks for every key of a batch if the container contains an element with that key. the home slots of a group
+     * of keys are prefetched before any key is compared, which hides most of the memory latency when the table is
+     * larger than the cache.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives bools.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives true or false for every key, in the order of the keys.
+     * @return - the output iterator past the last value written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator contains_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index)
+        {
+            *out++ = index != _capacity;
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
+    }
+
+    /**
+     * copies the mapped values of a batch of keys, prefetching as contains_many does. If one of the keys is not in
+     * the map, an exception of type std::out_of_range is thrown, after the values of the keys before it were written.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives values.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives the mapped value of every key, in the order of the keys.
+     * @return - the output iterator past the last value written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator at_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index)
+        {
+            if (index == _capacity)
+            {
+                throw std::out_of_range("Hash map does not contain the given key.");
+            }
+            *out++ = _slots[index].second;
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key. the table is never shrunk, so erasing does
+     * not move other elements.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        size_t index = _find(key, _hash(key));
+        if (index == _capacity)
+        {
+            return false;
+        }
+        _eraseAt(index);
+        return true;
+    }
+
+    /**
+     * Returns the ratio between the number of elements and the number of slots.
+     * @return - the load factor.
+     */
+    double load_factor() const
+    {
+        return (double) size() / (double) capacity();
+    }
+
+    FlatHashMap& operator =(const FlatHashMap& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        FlatHashMap copy(other);
+        std::swap(_hasher, copy._hasher);
+        std::swap(_keyEqual, copy._keyEqual);
+        std::swap(_ctrl, copy._ctrl);
+        std::swap(_slots, copy._slots);
+        std::swap(_capacity, copy._capacity);
+        std::swap(_size, copy._size);
+        std::swap(_growthLeft, copy._growthLeft);
+        return *this;
+    }
+
+    /**
+     * Erases all elements from the container. After this call, size() returns zero.
+     */
+    void clear()
+    {
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_ctrl[i] >= 0)
+            {
+                _slots[i].~pair();
+            }
+        }
+        std::memset(_ctrl, kEmpty, _capacity + kGroupWidth - 1);
+        _size = 0;
+        _growthLeft = _maxElements(_capacity);
+    }
+
+    /**
+     * Returns a reference to the value that is mapped to a key equivalent to key, inserting a default value if no
+     * such key exists.
+     * @param key - the key of the element to find.
+     * @return - reference to the mapped value of the element whose key is equivalent to key.
+     */
+    ValueT& operator [](const KeyT& key)
+    {
+        size_t hash = _hash(key);
+        size_t index = _find(key, hash);
+        if (index == _capacity)
+        {
+            index = _prepareInsert(hash);
+            new (_slots + index) pair<KeyT, ValueT>(key, ValueT());
+            _commitInsert(index, hash);
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * Returns the value that is mapped to a key equivalent to key.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the existing element whose key is equivalent to key, or a default value.
+     */
+    ValueT operator [](const KeyT& key) const
+    {
+        size_t index = _find(key, _hash(key));
+        if (index == _capacity)
+        {
+            return ValueT();
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * return a const iterator to the beginning of the map.
+     */
+    iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    /**
+     * @return - a const iterator to beginning of the map.
+     */
+    const_iterator cbegin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    /**
+     * return a const iterator to the end of the map.
+     */
+    iterator end() const
+    {
+        return const_iterator(this, _capacity);
+    }
+
+    /**
+     * return a const iterator to the end of the map.
+     */
+    const_iterator cend() const
+    {
+        return const_iterator(this, _capacity);
+    }
+
+    /**
+     * Compares the contents of two maps.
+     * @param lhs - map to compare.
+     * @param rhs - map to compare.
+     * @return - true if the contents of the maps are equal, false otherwise.
+     */
+    friend bool operator ==(const FlatHashMap& lhs, const FlatHashMap& rhs)
+    {
+        if (lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        for (const pair<KeyT, ValueT>& element : lhs)
+        {
+            size_t index = rhs._find(element.first, rhs._hash(element.first));
+            if (index == rhs._capacity || !(rhs._slots[index].second == element.second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Compares the contents of two maps.
+     * @param lhs - map to compare.
+     * @param rhs - map to compare.
+     * @return - false if the contents of the maps are equal, true otherwise.
+     */
+    friend bool operator !=(const FlatHashMap& lhs, const FlatHashMap& rhs)
+    {
+        return !(lhs == rhs);
+    }
+};
+
+
+#endif //SUMMEREX6_FLATHASHMAP_HPP
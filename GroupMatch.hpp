@@ -0,0 +1,139 @@
+#ifndef SUMMEREX6_GROUPMATCH_HPP
+#define SUMMEREX6_GROUPMATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(SUMMEREX6_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SUMMEREX6_GROUPMATCH_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * matches a group of kWidth one-byte tags against a value, as the probes of FlatHashMap do on every step.
+ * on x86 the group is compared with SSE2, two 16 byte halves at a time, or with a single AVX2 compare when the
+ * processor supports it, which is checked once at run time, so the binary needs no -mavx2. everywhere else, and
+ * when SUMMEREX6_NO_SIMD is defined, a scalar loop does the same.
+ */
+class GroupMatch
+{
+public:
+    enum : size_t
+    {
+        kWidth = 32
+    };
+
+    /**
+     * match every byte of a group against a value.
+     * @param group - first byte of the group, kWidth bytes are read.
+     * @param value - value to look for.
+     * @return - a mask with bit i set if group[i] equals value.
+     */
+    static uint32_t match(const signed char* group, signed char value)
+    {
+#ifdef SUMMEREX6_GROUPMATCH_X86
+        if (_hasAvx2())
+        {
+            return _matchAvx2(group, value);
+        }
+        return _matchSse2(group, value);
+#else
+        return match_scalar(group, value);
+#endif
+    }
+
+    /**
+     * match the negative bytes of a group.
+     * @param group - first byte of the group, kWidth bytes are read.
+     * @return - a mask with bit i set if group[i] is negative.
+     */
+    static uint32_t match_negative(const signed char* group)
+    {
+#ifdef SUMMEREX6_GROUPMATCH_X86
+        if (_hasAvx2())
+        {
+            return _negativeAvx2(group);
+        }
+        return _negativeSse2(group);
+#else
+        return match_negative_scalar(group);
+#endif
+    }
+
+    /**
+     * the portable form of match, always available.
+     * @param group - first byte of the group, kWidth bytes are read.
+     * @param value - value to look for.
+     * @return - a mask with bit i set if group[i] equals value.
+     */
+    static uint32_t match_scalar(const signed char* group, signed char value)
+    {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kWidth; ++i)
+        {
+            mask |= (uint32_t) (group[i] == value) << i;
+        }
+        return mask;
+    }
+
+    /**
+     * the portable form of match_negative, always available.
+     * @param group - first byte of the group, kWidth bytes are read.
+     * @return - a mask with bit i set if group[i] is negative.
+     */
+    static uint32_t match_negative_scalar(const signed char* group)
+    {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kWidth; ++i)
+        {
+            mask |= (uint32_t) (group[i] < 0) << i;
+        }
+        return mask;
+    }
+
+#ifdef SUMMEREX6_GROUPMATCH_X86
+private:
+    /**
+     * check once whether the processor supports AVX2.
+     * @return - true or false.
+     */
+    static bool _hasAvx2()
+    {
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+        return hasAvx2;
+    }
+
+    static uint32_t _matchSse2(const signed char* group, signed char value)
+    {
+        const __m128i pattern = _mm_set1_epi8(value);
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group + 16));
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(low, pattern)) |
+               (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(high, pattern)) << 16;
+    }
+
+    static uint32_t _negativeSse2(const signed char* group)
+    {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group + 16));
+        return (uint32_t) _mm_movemask_epi8(low) | (uint32_t) _mm_movemask_epi8(high) << 16;
+    }
+
+    __attribute__((target("avx2")))
+    static uint32_t _matchAvx2(const signed char* group, signed char value)
+    {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group));
+        return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(value)));
+    }
+
+    __attribute__((target("avx2")))
+    static uint32_t _negativeAvx2(const signed char* group)
+    {
+        return (uint32_t) _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(group)));
+    }
+#endif
+};
+
+
+#endif //SUMMEREX6_GROUPMATCH_HPP
@@ -7,10 +7,21 @@
 
 #include <iostream>
 #include <list>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <algorithm>
+#include <atomic>
 #include <exception>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include "HashMix.hpp"
+#include "InlineBucket.hpp"
+#include "Prefetch.hpp"
+#include "ThreadPool.hpp"
 using std::list;
 using std::vector;
 using std::pair;
@@ -21,11 +32,110 @@ using std::exception;
  * Search, insertion, and removal of elements have average constant-time complexity.
  * @tparam KeyT - key of each pair.
  * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys, wrap it in MixedHash when the low bits of its results are not random.
+ * @tparam KeyEqual - equality of the keys.
+ * @tparam StoreHash - whether every element keeps its hash code. resizes then never call Hash, and lookups compare
+ * the hash codes before the keys, at the cost of a size_t per element.
+ * @tparam Allocator - allocator of the elements, rebound to allocate the bucket array and the storage of every
+ * bucket. use PoolAllocator to serve the small bucket allocations from an arena that is freed at once.
+ * @tparam InlineBucketSize - number of elements every bucket holds without allocating, 0 to keep the buckets as
+ * vectors. with 1 or 2 most buckets never allocate, and a lookup reads the element right from the bucket array.
  */
-template<typename KeyT, typename ValueT>
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>,
+         bool StoreHash = false, typename Allocator = std::allocator<pair<KeyT, ValueT>>,
+         size_t InlineBucketSize = 0>
 class HashMap
 {
 private:
+    /**
+     * the part of an element that holds its hash code, empty unless the hash is stored.
+     * @tparam Stored - whether the hash code is stored.
+     */
+    template<bool Stored, typename Dummy = void>
+    struct CachedHash
+    {
+        void setHash(size_t)
+        {
+
+        }
+
+        bool hashEquals(size_t) const
+        {
+            return true;
+        }
+    };
+
+    template<typename Dummy>
+    struct CachedHash<true, Dummy>
+    {
+        size_t hash;
+
+        void setHash(size_t h)
+        {
+            hash = h;
+        }
+
+        bool hashEquals(size_t h) const
+        {
+            return hash == h;
+        }
+    };
+
+    /**
+     * an element of a bucket, a key-value pair along with its cached hash code.
+     */
+    struct Entry: public pair<KeyT, ValueT>, public CachedHash<StoreHash>
+    {
+        /**
+         * construct the pair in place.
+         * @tparam Args - types of the arguments to construct the pair from.
+         * @param hash - hash code of the key.
+         * @param args - arguments to construct the pair from.
+         */
+        template<typename... Args>
+        explicit Entry(size_t hash, Args&&... args): pair<KeyT, ValueT>(std::forward<Args>(args)...)
+        {
+            this->setHash(hash);
+        }
+    };
+
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Entry> EntryAllocator;
+
+    typedef typename std::conditional<InlineBucketSize == 0, vector<Entry, EntryAllocator>,
+                                      InlineBucket<Entry, InlineBucketSize, EntryAllocator>>::type Bucket;
+
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Bucket> BucketAllocator;
+
+    typedef std::allocator_traits<BucketAllocator> BucketTraits;
+
+    /**
+     * smallest number of buckets for which a resize or a copy is split between the threads of _pool, the number of
+     * buckets in a chunk, the smallest bucket whose elements are compared in hash order, and the number of keys a
+     * batched lookup prefetches at once.
+     */
+    enum : size_t
+    {
+        kParallelBuckets = 1 << 14,
+        kBucketsPerChunk = 1 << 12,
+        kSortedCompare = 8,
+        kLookupGroup = 16
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * allocator of the bucket arrays and of the storage of the buckets.
+     */
+    Allocator _allocator;
+
     /**
      * threshold to determine when to increase the table currNumOfElements.
      */
@@ -37,107 +147,1133 @@ private:
     double lowerThreshold{};
 
     /**
-     * maximum number of elements the hash _map can currently contain.
+     * whether erase decreases the table when the load drops below lowerThreshold.
+     */
+    bool _autoShrink = true;
+
+    /**
+     * capacity set by the last reserve, erase never decreases the table below it.
+     */
+    size_t _reservedCapacity = 1;
+
+    /**
+     * maximum number of elements the hash _map can currently contain.
+     */
+    int maxNumOfElements{};
+
+    /**
+     * number of elements the has _map currently holds.
+     */
+    int currNumOfElements{};
+
+    /**
+     * an array of struct bucket to hold elements.
+     */
+    Bucket *_map = nullptr;
+
+    /**
+     * while an incremental rehash is in progress, the buckets that are being moved into _map, otherwise nullptr.
+     */
+    Bucket *_oldMap = nullptr;
+
+    /**
+     * number of buckets in _oldMap.
+     */
+    size_t _oldCapacity{};
+
+    /**
+     * number of buckets of _oldMap that were already moved into _map, they are destroyed.
+     */
+    size_t _migrated{};
+
+    /**
+     * least number of old buckets moved by every insertion or removal during an incremental rehash, 0 if resizes
+     * rebuild the whole _map at once.
+     */
+    size_t _rehashStep{};
+
+    /**
+     * number of old buckets moved by every insertion or removal during the current incremental rehash, at least
+     * _rehashStep and enough to finish the rehash before the new _map reaches its upper threshold.
+     */
+    size_t _migrationStep{};
+
+    /**
+     * threads that resize and copy large maps, nullptr to do it on the calling thread.
+     */
+    ThreadPool* _pool = nullptr;
+
+    /**
+     * compare lengthe of 2 vectors represented by iterators.
+     * @tparam Iterator1 - type of 1st vector.
+     * @tparam Iterator2 - type of 2st vector.
+     * @param iterator1Begin - beginning of 1st vector.
+     * @param iterator1End - ending of 1nd vector.
+     * @param iterator2Begin - beginning of 2nd vector.
+     * @param iterator2End - ending of 2nd vector.
+     * @return - -1 if of different sizes, length if are the same.
+     */
+    template<typename Iterator1, typename Iterator2>
+    int _areSizesEqual(Iterator1 iterator1Begin, Iterator1 iterator1End, Iterator2 iterator2Begin, Iterator2 iterator2End)
+    {
+        int lenOfFirst = 0;
+        int lenOfSecond = 0;
+        for (auto i = iterator1Begin; i != iterator1End ; ++i)
+        {
+            lenOfFirst++;
+        }
+        for (auto i = iterator2Begin; i != iterator2End ; ++i)
+        {
+            lenOfSecond++;
+        }
+        if (lenOfFirst != lenOfSecond)
+        {
+            return -1;
+        }
+        return lenOfFirst;
+    }
+
+    /**
+     * get the hash code of a given value.
+     * @param v - value to generate hash code on.
+     * @return - hash code.
+     */
+    int _clamp(size_t v, size_t capacity) const
+    {
+        return v & (capacity - 1);
+    }
+
+    /**
+     * get the hash code of an element, without calling Hash if it is stored.
+     * @param entry - the element.
+     * @return - hash code of the key of the element.
+     */
+    size_t _entryHash(const Entry& entry) const
+    {
+        return _entryHash(entry, std::integral_constant<bool, StoreHash>());
+    }
+
+    size_t _entryHash(const Entry& entry, std::true_type) const
+    {
+        return entry.hash;
+    }
+
+    size_t _entryHash(const Entry& entry, std::false_type) const
+    {
+        return _hasher(entry.first);
+    }
+
+    /**
+     * get the hash code of an element if it is stored, for _position, which only compares hash codes that are stored.
+     * @param entry - the element.
+     * @return - the stored hash code, or 0.
+     */
+    static size_t _storedHash(const Entry& entry)
+    {
+        return _storedHash(entry, std::integral_constant<bool, StoreHash>());
+    }
+
+    static size_t _storedHash(const Entry& entry, std::true_type)
+    {
+        return entry.hash;
+    }
+
+    static size_t _storedHash(const Entry&, std::false_type)
+    {
+        return 0;
+    }
+
+    /**
+     * allocate an array of empty buckets, all of which allocate their elements with _allocator.
+     * @param count - number of buckets.
+     * @return - pointer to the first bucket.
+     */
+    Bucket* _newBuckets(size_t count)
+    {
+        BucketAllocator allocator(_allocator);
+        Bucket* buckets = BucketTraits::allocate(allocator, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            BucketTraits::construct(allocator, buckets + i, EntryAllocator(_allocator));
+        }
+        return buckets;
+    }
+
+    /**
+     * destroy the buckets of _map and _oldMap that exist while an incremental rehash is in progress, free both arrays,
+     * and leave the _map without buckets.
+     */
+    void _deleteMaps()
+    {
+        BucketAllocator allocator(_allocator);
+        if (_map != nullptr)
+        {
+            for (size_t i = 0; i < capacity(); ++i)
+            {
+                if (_isBuilt(i))
+                {
+                    BucketTraits::destroy(allocator, _map + i);
+                }
+            }
+            BucketTraits::deallocate(allocator, _map, capacity());
+        }
+        if (_oldMap != nullptr)
+        {
+            for (size_t i = _migrated; i < _oldCapacity; ++i)
+            {
+                BucketTraits::destroy(allocator, _oldMap + i);
+            }
+            BucketTraits::deallocate(allocator, _oldMap, _oldCapacity);
+        }
+        _map = nullptr;
+        _oldMap = nullptr;
+        _oldCapacity = 0;
+        _migrated = 0;
+    }
+
+    /**
+     * destroy an array of buckets allocated by _newBuckets and free it.
+     * @param buckets - pointer to the first bucket, may be nullptr.
+     * @param count - number of buckets.
+     */
+    void _deleteBuckets(Bucket* buckets, size_t count)
+    {
+        if (buckets == nullptr)
+        {
+            return;
+        }
+        BucketAllocator allocator(_allocator);
+        for (size_t i = 0; i < count; ++i)
+        {
+            BucketTraits::destroy(allocator, buckets + i);
+        }
+        BucketTraits::deallocate(allocator, buckets, count);
+    }
+
+    /**
+     * get the number of buckets that may hold elements, those of _map followed by those of _oldMap.
+     * @return - the number of buckets.
+     */
+    size_t _bucketCount() const
+    {
+        return capacity() + _oldCapacity;
+    }
+
+    /**
+     * get a bucket by its index in the sequence of _map buckets followed by _oldMap buckets.
+     * @param index - index of the bucket, less than _bucketCount().
+     * @return - the bucket.
+     */
+    Bucket& _bucketAt(size_t index) const
+    {
+        return index < capacity() ? _map[index] : _oldMap[index - capacity()];
+    }
+
+    /**
+     * check whether a bucket of _map was constructed. during an incremental rehash a bucket of _map is constructed
+     * only when the first old bucket whose elements go to it is moved, and until then the keys it would hold are
+     * still added to their old bucket.
+     * @param index - index of the bucket in _map.
+     * @return - true or false.
+     */
+    bool _isBuilt(size_t index) const
+    {
+        return _oldMap == nullptr || (size_t) _clamp(index, std::min((size_t) capacity(), _oldCapacity)) < _migrated;
+    }
+
+    /**
+     * get the number of elements in a bucket, 0 for the buckets that do not exist during an incremental rehash.
+     * @param index - index of the bucket as used by _bucketAt.
+     * @return - the number of elements.
+     */
+    size_t _bucketSize(size_t index) const
+    {
+        if (index < capacity())
+        {
+            return _isBuilt(index) ? _map[index].size() : 0;
+        }
+        return index - capacity() >= _migrated ? _oldMap[index - capacity()].size() : 0;
+    }
+
+    /**
+     * get the position of a key in a bucket.
+     * @param bucket - the bucket to search.
+     * @param hash - hash code of the key.
+     * @param key - the key to look for.
+     * @return - index of the element with the given key, or the size of the bucket if there is none.
+     */
+    size_t _position(const Bucket& bucket, size_t hash, const KeyT& key) const
+    {
+        size_t pos = 0;
+        while (pos < bucket.size() && !(bucket[pos].hashEquals(hash) && _keyEqual(bucket[pos].first, key)))
+        {
+            pos++;
+        }
+        return pos;
+    }
+
+    /**
+     * find a key in _map, and while rehashing also in the bucket of _oldMap it has not been moved out of yet.
+     * @param hash - hash code of the key.
+     * @param key - the key to look for.
+     * @param pos - set to the position of the key in its bucket.
+     * @return - index of the bucket holding the key as used by _bucketAt, or _bucketCount() if there is none.
+     */
+    size_t _locate(size_t hash, const KeyT& key, size_t& pos) const
+    {
+        size_t index = _clamp(hash, capacity());
+        if (_isBuilt(index))
+        {
+            pos = _position(_map[index], hash, key);
+            if (pos != _map[index].size())
+            {
+                return index;
+            }
+        }
+        if (_oldMap != nullptr)
+        {
+            size_t oldIndex = _clamp(hash, _oldCapacity);
+            if (oldIndex >= _migrated)
+            {
+                pos = _position(_oldMap[oldIndex], hash, key);
+                if (pos != _oldMap[oldIndex].size())
+                {
+                    return capacity() + oldIndex;
+                }
+            }
+        }
+        return _bucketCount();
+    }
+
+    /**
+     * look up a sequence of keys in groups. every key of a group is hashed and its bucket prefetched, then the
+     * elements of every bucket are prefetched, and only then are the keys compared, so the cache misses of a group
+     * overlap instead of stalling one after the other.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam Visitor - type of the visitor, callable with the index of a bucket as used by _bucketAt and a position
+     * in it, the index is _bucketCount() if the key is not in the map.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param visit - called once for every key, in order.
+     */
+    template<typename ForwardIterator, typename Visitor>
+    void _lookupMany(ForwardIterator keysBegin, ForwardIterator keysEnd, Visitor& visit) const
+    {
+        const KeyT* keys[kLookupGroup];
+        size_t hashes[kLookupGroup];
+        while (keysBegin != keysEnd)
+        {
+            size_t count = 0;
+            for (; keysBegin != keysEnd && count < kLookupGroup; ++keysBegin, ++count)
+            {
+                keys[count] = std::addressof(*keysBegin);
+                hashes[count] = _hasher(*keys[count]);
+                prefetch_read(_map + _clamp(hashes[count], capacity()));
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t index = _clamp(hashes[i], capacity());
+                if (_isBuilt(index))
+                {
+                    prefetch_read(_map[index].data());
+                }
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t pos;
+                size_t index = _locate(hashes[i], *keys[i], pos);
+                visit(index, pos);
+            }
+        }
+    }
+
+    /**
+     * move buckets of _oldMap into _map, and free _oldMap once all of them were moved. the buckets of _map that an
+     * old bucket feeds are constructed right before it is moved, and the old bucket is destroyed right after, so no
+     * step touches more than its own buckets.
+     * @param buckets - maximal number of buckets to move.
+     */
+    void _migrate(size_t buckets)
+    {
+        BucketAllocator allocator(_allocator);
+        size_t end = std::min(_oldCapacity, _migrated + buckets);
+        for (; _migrated < end; ++_migrated)
+        {
+            for (size_t i = _migrated; i < capacity(); i += _oldCapacity)
+            {
+                BucketTraits::construct(allocator, _map + i, EntryAllocator(_allocator));
+            }
+            Bucket& source = _oldMap[_migrated];
+            for (Entry& element : source)
+            {
+                _map[_clamp(_entryHash(element), capacity())].push_back(std::move(element));
+            }
+            BucketTraits::destroy(allocator, &source);
+        }
+        if (_migrated == _oldCapacity)
+        {
+            BucketTraits::deallocate(allocator, _oldMap, _oldCapacity);
+            _oldMap = nullptr;
+            _oldCapacity = 0;
+            _migrated = 0;
+        }
+    }
+
+    /**
+     * remove an element from its bucket, and move on the incremental rehash or shrink the _map as a removal does.
+     * @param index - index of the bucket as used by _bucketAt.
+     * @param pos - position of the element in the bucket.
+     */
+    void _eraseAt(size_t index, size_t pos)
+    {
+        Bucket& bucket = _bucketAt(index);
+        bucket.erase(bucket.begin() + pos);
+        this->currNumOfElements--;
+        if (_oldMap != nullptr)
+        {
+            _migrate(_migrationStep);
+        }
+        else if (_autoShrink && capacity() > _reservedCapacity && load_factor() < this->lowerThreshold)
+        {
+            _decreaseMapSize();
+        }
+    }
+
+    /**
+     * shrink the _map once after many removals, to the capacity that removing the elements one by one would have
+     * left it at, but not below the reserved capacity.
+     */
+    void _shrinkToLoad()
+    {
+        if (!_autoShrink)
+        {
+            return;
+        }
+        size_t updatedCap = capacity();
+        while (updatedCap > _reservedCapacity && (double) size() / (double) updatedCap < this->lowerThreshold)
+        {
+            updatedCap /= 2;
+        }
+        _rehashTo(updatedCap);
+    }
+
+    /**
+     * complete an incremental rehash, if one is in progress.
+     */
+    void _finishRehash()
+    {
+        if (_oldMap != nullptr)
+        {
+            _migrate(_oldCapacity);
+        }
+    }
+
+    /**
+     * replace _map by an array of buckets that are not constructed yet and let later insertions and removals move
+     * the elements into it. every operation moves enough old buckets that the rehash ends before the elements
+     * inserted meanwhile reach the upper threshold of the new capacity, so the next resize never has to wait for it.
+     * @param updatedCap - capacity of the new _map.
+     */
+    void _startRehash(size_t updatedCap)
+    {
+        BucketAllocator allocator(_allocator);
+        _oldMap = _map;
+        _oldCapacity = capacity();
+        _migrated = 0;
+        _map = BucketTraits::allocate(allocator, updatedCap);
+        maxNumOfElements = updatedCap;
+        size_t fitting = (size_t) ((double) updatedCap * this->upperThreshold);
+        size_t headroom = fitting > size() ? fitting - size() : 1;
+        _migrationStep = std::max(_rehashStep, (_oldCapacity + headroom - 1) / headroom);
+    }
+
+    /**
+     * add an element whose key is not in the _map yet. the _map is grown before the element is added, so the
+     * returned reference stays valid. while an incremental rehash is in progress the _map is not grown, and a key
+     * whose bucket in _map was not constructed yet goes to its old bucket, which was not moved yet either.
+     * @tparam Args - types of the arguments to construct the element from.
+     * @param hash - hash code of the key.
+     * @param args - arguments to construct the element from.
+     * @return - reference to the inserted element.
+     */
+    template<typename... Args>
+    pair<KeyT, ValueT>& _emplaceNew(size_t hash, Args&&... args)
+    {
+        if (_oldMap != nullptr)
+        {
+            _migrate(_migrationStep);
+        }
+        if (_oldMap == nullptr && (double) (size() + 1) / (double) capacity() > this->upperThreshold)
+        {
+            _increaseMapSize();
+        }
+        int index = _clamp(hash, capacity());
+        Bucket& bucket = _isBuilt(index) ? _map[index] : _oldMap[_clamp(hash, _oldCapacity)];
+        bucket.emplace_back(hash, std::forward<Args>(args)...);
+        currNumOfElements++;
+        return bucket.back();
+    }
+
+    /**
+     * insert an element if its key is not in the _map yet.
+     * @tparam K - type of the key, KeyT or a reference to it.
+     * @tparam V - type of the value, ValueT or a reference to it.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    template<typename K, typename V>
+    bool _insert(K&& key, V&& value)
+    {
+        size_t hash = _hasher(key);
+        size_t pos;
+        if (_locate(hash, key, pos) != _bucketCount())
+        {
+            return false;
+        }
+        _emplaceNew(hash, std::forward<K>(key), std::forward<V>(value));
+        return true;
+    }
+
+    /**
+     * construct an element in place if its key is not in the _map yet.
+     * @tparam K - type of the key, KeyT or a reference to it.
+     * @tparam Args - types of the arguments to construct the value from.
+     * @param key - key to insert.
+     * @param args - arguments to construct the value from, used only if the key is inserted.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    template<typename K, typename... Args>
+    bool _tryEmplace(K&& key, Args&&... args)
+    {
+        size_t hash = _hasher(key);
+        size_t pos;
+        if (_locate(hash, key, pos) != _bucketCount())
+        {
+            return false;
+        }
+        _emplaceNew(hash, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+        return true;
+    }
+
+    /**
+     * assign a value to a key, inserting the key if it is not in the _map yet.
+     * @tparam K - type of the key, KeyT or a reference to it.
+     * @tparam V - type of the value.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the key was inserted, false if an existing value was assigned.
+     */
+    template<typename K, typename V>
+    bool _insertOrAssign(K&& key, V&& value)
+    {
+        size_t hash = _hasher(key);
+        size_t pos;
+        size_t index = _locate(hash, key, pos);
+        if (index != _bucketCount())
+        {
+            _bucketAt(index)[pos].second = std::forward<V>(value);
+            return false;
+        }
+        _emplaceNew(hash, std::forward<K>(key), std::forward<V>(value));
+        return true;
+    }
+
+    /**
+     * get the value mapped to a key, inserting a default value if the key is not in the _map yet.
+     * @tparam K - type of the key, KeyT or a reference to it.
+     * @param key - the key of the element to find.
+     * @return - reference to the mapped value.
+     */
+    template<typename K>
+    ValueT& _findOrInsert(K&& key)
+    {
+        size_t hash = _hasher(key);
+        size_t pos;
+        size_t index = _locate(hash, key, pos);
+        if (index == _bucketCount())
+        {
+            return _emplaceNew(hash, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                               std::forward_as_tuple()).second;
+        }
+        return _bucketAt(index)[pos].second;
+    }
+
+    /**
+     * call a function on chunks of a range of buckets, split between the threads of a pool when the range is large.
+     * @tparam Function - type of the function, callable with the first and the past the last bucket of a chunk.
+     * @param pool - the pool, or nullptr to call the function once on the whole range.
+     * @param count - number of buckets.
+     * @param function - the function to call.
+     */
+    template<typename Function>
+    static void _forEachChunk(ThreadPool* pool, size_t count, Function function)
+    {
+        if (pool == nullptr || count < kParallelBuckets)
+        {
+            function((size_t) 0, count);
+            return;
+        }
+        pool->parallel_for(0, count, kBucketsPerChunk, function);
+    }
+
+    /**
+     * call a function on every index of a range of buckets, split into chunks between the threads of _pool when the
+     * range is large. the function must only touch buckets that no other index touches.
+     * @tparam Function - type of the function, callable with the index of a bucket.
+     * @param count - number of buckets.
+     * @param function - the function to call.
+     */
+    template<typename Function>
+    void _forEachBucket(size_t count, Function function) const
+    {
+        _forEachChunk(_pool, count, [&function](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                function(i);
+            }
+        });
+    }
+
+    /**
+     * add the elements of other maps to this one, combining the values of keys that are already present. every
+     * bucket of this _map gathers its elements from the buckets of the sources that map to it, so the buckets are
+     * filled by the threads of a pool without locking. Hash is only called for the elements of sources with fewer
+     * buckets than this _map, and not at all if the hash codes are stored.
+     * @tparam Combiner - type of the combiner, callable with ValueT& and const ValueT&.
+     * the _map is first grown to fit the largest source, completing that resize at once even with incremental rehash
+     * on, since the buckets are gathered from _map alone. it may grow again at the end if the result needs it.
+     * @param sources - the maps to add, they are not modified and no rehash may be in progress in them.
+     * @param numOfSources - number of maps.
+     * @param combine - called with the value in this _map and the value being added when a key is in both.
+     * @param pool - the pool, or nullptr to do all work on the calling thread.
+     */
+    template<typename Combiner>
+    void _combine(const HashMap* const* sources, size_t numOfSources, Combiner& combine, ThreadPool* pool)
+    {
+        _finishRehash();
+        size_t largest = 0;
+        for (size_t s = 0; s < numOfSources; ++s)
+        {
+            largest = std::max(largest, sources[s]->size());
+        }
+        _grow(std::max(size(), largest));
+        _finishRehash();
+        size_t cap = capacity();
+        std::atomic<size_t> added(0);
+        _forEachChunk(pool, cap, [this, sources, numOfSources, &combine, cap, &added](size_t begin, size_t end)
+        {
+            size_t addedInChunk = 0;
+            for (size_t t = begin; t < end; ++t)
+            {
+                Bucket& target = _map[t];
+                for (size_t s = 0; s < numOfSources; ++s)
+                {
+                    const HashMap& source = *sources[s];
+                    size_t sourceCap = source.capacity();
+                    size_t first = sourceCap >= cap ? t : _clamp(t, sourceCap);
+                    size_t step = sourceCap >= cap ? cap : sourceCap;
+                    for (size_t b = first; b < sourceCap; b += step)
+                    {
+                        for (const Entry& element : source._map[b])
+                        {
+                            if (sourceCap < cap && (size_t) _clamp(source._entryHash(element), cap) != t)
+                            {
+                                continue;
+                            }
+                            size_t pos = _position(target, _storedHash(element), element.first);
+                            if (pos != target.size())
+                            {
+                                combine(target[pos].second, element.second);
+                            }
+                            else
+                            {
+                                target.push_back(element);
+                                addedInChunk++;
+                            }
+                        }
+                    }
+                }
+            }
+            added.fetch_add(addedInChunk, std::memory_order_relaxed);
+        });
+        currNumOfElements += (int) added.load();
+        if (load_factor() > this->upperThreshold)
+        {
+            _rehashTo(_capacityFor(size()));
+        }
+    }
+
+    /**
+     * increase the size of the _map. since the capacity is a power of two, the elements of bucket i go either to
+     * bucket i or to bucket i + capacity(), so each bucket keeps its storage and only hands over the elements whose
+     * hash has the capacity() bit set. no two source buckets write to the same bucket, so the work is split between
+     * the threads of _pool.
+     */
+    void _increaseMapSize()
+    {
+        _finishRehash();
+        if (_rehashStep != 0)
+        {
+            _startRehash(capacity() * 2);
+            return;
+        }
+        size_t oldCap = capacity();
+        Bucket* toReplace = _newBuckets(oldCap * 2);
+        _forEachBucket(oldCap, [this, toReplace, oldCap](size_t i)
+        {
+            Bucket& low = toReplace[i];
+            Bucket& high = toReplace[i + oldCap];
+            low.swap(_map[i]);
+            size_t kept = 0;
+            for (size_t j = 0; j < low.size(); ++j)
+            {
+                if (_entryHash(low[j]) & oldCap)
+                {
+                    high.push_back(std::move(low[j]));
+                }
+                else
+                {
+                    if (kept != j)
+                    {
+                        low[kept] = std::move(low[j]);
+                    }
+                    kept++;
+                }
+            }
+            low.erase(low.begin() + kept, low.end());
+        });
+        _deleteBuckets(_map, oldCap);
+        maxNumOfElements *= 2;
+        _map = toReplace;
+    }
+
+    /**
+     * decrease the size of the _map. bucket i of the smaller _map holds exactly the elements of buckets i and
+     * i + capacity() / 2, so no hash code is needed and the buckets are merged by the threads of _pool.
+     */
+    void _decreaseMapSize()
+    {
+        _finishRehash();
+        size_t updatedCap = capacity() / 2;
+        if (_rehashStep != 0)
+        {
+            _startRehash(updatedCap);
+            return;
+        }
+        Bucket* toReplace = _newBuckets(updatedCap);
+        _forEachBucket(updatedCap, [this, toReplace, updatedCap](size_t i)
+        {
+            toReplace[i].swap(_map[i]);
+            for (Entry& element : _map[i + updatedCap])
+            {
+                toReplace[i].push_back(std::move(element));
+            }
+        });
+        _deleteBuckets(_map, capacity());
+        this->maxNumOfElements = updatedCap;
+        _map = toReplace;
+    }
+
+    /**
+     * rebuild the _map with any power of two capacity. halving and doubling keep their dedicated paths, other
+     * capacities move every element to the bucket its hash code selects.
+     * @param updatedCap - the new capacity.
+     */
+    void _rehashTo(size_t updatedCap)
+    {
+        if (updatedCap == capacity())
+        {
+            return;
+        }
+        if (updatedCap == capacity() * 2)
+        {
+            _increaseMapSize();
+            return;
+        }
+        if (updatedCap * 2 == capacity())
+        {
+            _decreaseMapSize();
+            return;
+        }
+        _finishRehash();
+        if (_rehashStep != 0)
+        {
+            _startRehash(updatedCap);
+            return;
+        }
+        Bucket* toReplace = _newBuckets(updatedCap);
+        for (size_t i = 0; i < capacity(); ++i)
+        {
+            for (Entry& element : _map[i])
+            {
+                toReplace[_clamp(_entryHash(element), updatedCap)].push_back(std::move(element));
+            }
+        }
+        _deleteBuckets(_map, capacity());
+        this->maxNumOfElements = updatedCap;
+        _map = toReplace;
+    }
+
+    /**
+     * fill the _map from ranges that can only be walked, one pair at a time. a key that appears more than once gets
+     * its last value.
+     */
+    template<typename KeysInputIterator, typename ValuesInputIterator>
+    void _build(KeysInputIterator keysBegin, KeysInputIterator keysEnd, ValuesInputIterator valuesBegin,
+                ValuesInputIterator valuesEnd, std::false_type)
+    {
+        int sizesEqual = _areSizesEqual(keysBegin, keysEnd, valuesBegin, valuesEnd);
+        if (sizesEqual < 0)
+        {
+            _deleteBuckets(_map, capacity());
+            _map = nullptr;
+            throw std::length_error("given vectors are of different size.");
+        }
+        auto key = keysBegin;
+        auto value = valuesBegin;
+        while (key != keysEnd && value != valuesEnd)
+        {
+            this->operator[](*key) = *value;
+            key++;
+            value++;
+        }
+    }
+
+    /**
+     * fill the empty _map from random access ranges. the capacity is set once from the length of the ranges. with a
+     * pool the keys are hashed in parallel, scattered by a counting sort into partitions of consecutive buckets, and
+     * every partition is filled by one thread. the scatter is stable, so a key that appears more than once gets its
+     * last value as on the other path.
+     */
+    template<typename KeysIterator, typename ValuesIterator>
+    void _build(KeysIterator keysBegin, KeysIterator keysEnd, ValuesIterator valuesBegin, ValuesIterator valuesEnd,
+                std::true_type)
+    {
+        if (keysEnd - keysBegin != valuesEnd - valuesBegin)
+        {
+            throw std::length_error("given vectors are of different size.");
+        }
+        size_t numOfPairs = keysEnd - keysBegin;
+        _rehashTo(std::max(capacity(), _capacityFor(numOfPairs)));
+        size_t cap = capacity();
+        if (_pool == nullptr || _pool->size() == 0 || numOfPairs < kParallelBuckets)
+        {
+            for (size_t i = 0; i < numOfPairs; ++i)
+            {
+                size_t hash = _hasher(keysBegin[i]);
+                currNumOfElements += _assign(_map[_clamp(hash, cap)], hash, keysBegin[i], valuesBegin[i]);
+            }
+            return;
+        }
+        size_t numOfChunks = (_pool->size() + 1) * 4;
+        size_t numOfParts = 1;
+        while (numOfParts < numOfChunks && numOfParts < cap)
+        {
+            numOfParts *= 2;
+        }
+        size_t partShift = 0;
+        while ((numOfParts << partShift) < cap)
+        {
+            partShift++;
+        }
+        size_t chunkSize = (numOfPairs + numOfChunks - 1) / numOfChunks;
+        vector<size_t> hashes(numOfPairs);
+        vector<size_t> offsets(numOfChunks * numOfParts, 0);
+        _pool->parallel_for(0, numOfChunks, 1, [&](size_t chunk, size_t)
+        {
+            size_t* counts = &offsets[chunk * numOfParts];
+            for (size_t i = chunk * chunkSize; i < std::min(numOfPairs, (chunk + 1) * chunkSize); ++i)
+            {
+                hashes[i] = _hasher(keysBegin[i]);
+                counts[_clamp(hashes[i], cap) >> partShift]++;
+            }
+        });
+        vector<size_t> partBegin(numOfParts + 1, 0);
+        size_t total = 0;
+        for (size_t part = 0; part < numOfParts; ++part)
+        {
+            partBegin[part] = total;
+            for (size_t chunk = 0; chunk < numOfChunks; ++chunk)
+            {
+                size_t count = offsets[chunk * numOfParts + part];
+                offsets[chunk * numOfParts + part] = total;
+                total += count;
+            }
+        }
+        partBegin[numOfParts] = total;
+        vector<size_t> order(numOfPairs);
+        _pool->parallel_for(0, numOfChunks, 1, [&](size_t chunk, size_t)
+        {
+            size_t* next = &offsets[chunk * numOfParts];
+            for (size_t i = chunk * chunkSize; i < std::min(numOfPairs, (chunk + 1) * chunkSize); ++i)
+            {
+                order[next[_clamp(hashes[i], cap) >> partShift]++] = i;
+            }
+        });
+        std::atomic<size_t> added(0);
+        _pool->parallel_for(0, numOfParts, 1, [&](size_t part, size_t)
+        {
+            size_t addedInPart = 0;
+            for (size_t k = partBegin[part]; k < partBegin[part + 1]; ++k)
+            {
+                size_t i = order[k];
+                addedInPart += _assign(_map[_clamp(hashes[i], cap)], hashes[i], keysBegin[i], valuesBegin[i]);
+            }
+            added.fetch_add(addedInPart, std::memory_order_relaxed);
+        });
+        currNumOfElements += (int) added.load();
+    }
+
+    /**
+     * assign a value to a key in a given bucket, adding the key if it is not there. the _map is never resized.
+     * @param bucket - the bucket of the key.
+     * @param hash - hash code of the key.
+     * @param key - the key.
+     * @param value - the value.
+     * @return - 1 if the key was added, 0 if it was already there.
      */
-    int maxNumOfElements{};
+    template<typename K, typename V>
+    int _assign(Bucket& bucket, size_t hash, K&& key, V&& value)
+    {
+        size_t pos = _position(bucket, hash, key);
+        if (pos != bucket.size())
+        {
+            bucket[pos].second = std::forward<V>(value);
+            return 0;
+        }
+        bucket.emplace_back(hash, std::forward<K>(key), std::forward<V>(value));
+        return 1;
+    }
 
     /**
-     * number of elements the has _map currently holds.
+     * get the smallest capacity that holds a number of elements without exceeding upperThreshold.
+     * @param numOfElements - the number of elements.
+     * @return - a power of two capacity.
      */
-    int currNumOfElements{};
+    size_t _capacityFor(size_t numOfElements) const
+    {
+        size_t cap = 1;
+        while ((double) numOfElements > (double) cap * this->upperThreshold)
+        {
+            cap *= 2;
+        }
+        return cap;
+    }
 
     /**
-     * an array of struct bucket to hold elements.
+     * increase the capacity so that a number of elements fit without any further resize, unlike reserve it sets no
+     * floor for later shrinking.
+     * @param numOfElements - number of elements the _map should hold.
      */
-    vector<pair<KeyT, ValueT>> *_map = nullptr;
+    void _grow(size_t numOfElements)
+    {
+        size_t updatedCap = _capacityFor(numOfElements);
+        if (updatedCap > capacity())
+        {
+            _rehashTo(updatedCap);
+        }
+    }
 
     /**
-     * compare lengthe of 2 vectors represented by iterators.
-     * @tparam Iterator1 - type of 1st vector.
-     * @tparam Iterator2 - type of 2st vector.
-     * @param iterator1Begin - beginning of 1st vector.
-     * @param iterator1End - ending of 1nd vector.
-     * @param iterator2Begin - beginning of 2nd vector.
-     * @param iterator2End - ending of 2nd vector.
-     * @return - -1 if of different sizes, length if are the same.
+     * check that a pair of thresholds leaves a gap between growing and shrinking: after doubling the load is half
+     * of upper and after halving it is twice lower, so neither may trigger the opposite resize.
+     * @param upper - threshold to increase the table.
+     * @param lower - threshold to decrease the table.
      */
-    template<typename Iterator1, typename Iterator2>
-    int _areSizesEqual(Iterator1 iterator1Begin, Iterator1 iterator1End, Iterator2 iterator2Begin, Iterator2 iterator2End)
+    static void _checkThresholds(double upper, double lower)
     {
-        int lenOfFirst = 0;
-        int lenOfSecond = 0;
-        for (auto i = iterator1Begin; i != iterator1End ; ++i)
-        {
-            lenOfFirst++;
-        }
-        for (auto i = iterator2Begin; i != iterator2End ; ++i)
-        {
-            lenOfSecond++;
-        }
-        if (lenOfFirst != lenOfSecond)
+        if (!(upper > 0 && lower >= 0 && lower < upper / 2))
         {
-            return -1;
+            throw std::invalid_argument("thresholds must satisfy 0 <= lower < upper / 2.");
         }
-        return lenOfFirst;
     }
 
     /**
-     * get the hash code of a given value.
-     * @param v - value to generate hash code on.
-     * @return - hash code.
+     * exchange the contents of two maps.
+     * @param other - map to exchange with.
      */
-    int _clamp(size_t v, size_t capacity) const
+    void _swap(HashMap& other)
     {
-        return v & (capacity - 1);
+        std::swap(_hasher, other._hasher);
+        std::swap(_keyEqual, other._keyEqual);
+        std::swap(_allocator, other._allocator);
+        std::swap(upperThreshold, other.upperThreshold);
+        std::swap(lowerThreshold, other.lowerThreshold);
+        std::swap(_autoShrink, other._autoShrink);
+        std::swap(_reservedCapacity, other._reservedCapacity);
+        std::swap(maxNumOfElements, other.maxNumOfElements);
+        std::swap(currNumOfElements, other.currNumOfElements);
+        std::swap(_map, other._map);
+        std::swap(_oldMap, other._oldMap);
+        std::swap(_oldCapacity, other._oldCapacity);
+        std::swap(_migrated, other._migrated);
+        std::swap(_migrationStep, other._migrationStep);
+        std::swap(_rehashStep, other._rehashStep);
+        std::swap(_pool, other._pool);
     }
 
     /**
-     * increase the size of the _map.
+     * copy the elements of another map into this one, whose _map has the same capacity and is empty. every bucket is
+     * copied straight into its place.
+     * @param other - map to copy from.
+     * @param pool - threads to split the buckets between, or nullptr.
      */
-    void _increaseMapSize()
+    void _copyElements(const HashMap& other, ThreadPool* pool)
     {
-        auto* toReplace = new vector<pair<KeyT, ValueT>>[capacity() * 2]();
-        for (size_t i = 0; i < capacity(); i++)
+        _forEachChunk(pool, other.capacity(), [this, &other](size_t begin, size_t end)
         {
-            vector<pair<KeyT, ValueT>>& list = _map[i];
-            if (!list.empty())
+            for (size_t i = begin; i < end; ++i)
             {
-                for (pair<KeyT, ValueT> pair : list)
+                if (other._isBuilt(i))
                 {
-                    int index = _clamp(std::hash<KeyT>{}(pair.first), capacity() * 2);
-                    toReplace[index].push_back(pair);
+                    _map[i] = other._map[i];
                 }
             }
+        });
+        for (size_t i = other._migrated; i < other._oldCapacity; ++i)
+        {
+            for (const Entry& element : other._oldMap[i])
+            {
+                _map[_clamp(_entryHash(element), capacity())].push_back(element);
+            }
         }
-        maxNumOfElements *= 2;
-        delete [] _map;
-        _map = nullptr;
-        _map = toReplace;
     }
 
     /**
-     * decrease the size of the _map.
+     * copy the elements of this map whose key is, or is not, in another map. the result has the capacity of this
+     * map while it is filled, so every bucket of it is filled from the same bucket of this map by one thread. when
+     * both maps have the same capacity a key is only looked for in the bucket of other with the same index,
+     * otherwise it is looked up in other as usual.
+     * @param other - the map to look the keys up in.
+     * @param keepCommon - true to keep the elements whose key is in other, false to keep the others.
+     * @param pool - threads to split the buckets between, or nullptr.
+     * @return - the map of the kept elements, shrunk once to fit them.
      */
-    void _decreaseMapSize()
+    HashMap _filter(const HashMap& other, bool keepCommon, ThreadPool* pool) const
     {
-        size_t updatedCap = capacity() / 2;
-        auto* toReplace = new vector<pair<KeyT, ValueT>>[updatedCap]();
-        for (int i = 0; i < capacity(); ++i)
+        HashMap result(upperThreshold, lowerThreshold, _hasher, _keyEqual,
+                       std::allocator_traits<Allocator>::select_on_container_copy_construction(_allocator));
+        result._autoShrink = _autoShrink;
+        result._rehashStep = _rehashStep;
+        result._pool = _pool;
+        if (rehashing() || other.rehashing())
         {
-            vector<pair<KeyT, ValueT>>& list = _map[i];
-            if (!list.empty())
+            for (const pair<KeyT, ValueT>& element : *this)
             {
-                for (pair<KeyT, ValueT> pair : list)
+                if (other.contains_key(element.first) == keepCommon)
                 {
-                    int index = _clamp(std::hash<KeyT>{}(pair.first), capacity() / 2);
-                    toReplace[index].push_back(pair);
+                    result.insert(element.first, element.second);
                 }
             }
+            return result;
         }
-        this->maxNumOfElements = updatedCap;
-        delete [] _map;
-        _map = nullptr;
-        _map = toReplace;
+        result._deleteBuckets(result._map, result.capacity());
+        result._map = nullptr;
+        result.maxNumOfElements = maxNumOfElements;
+        result._map = result._newBuckets(capacity());
+        const bool aligned = other.capacity() == capacity();
+        std::atomic<size_t> kept(0);
+        _forEachChunk(pool, capacity(), [this, &other, &result, keepCommon, aligned, &kept](size_t begin, size_t end)
+        {
+            size_t keptInChunk = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                for (const Entry& element : _map[i])
+                {
+                    bool common;
+                    if (aligned)
+                    {
+                        const Bucket& bucket = other._map[i];
+                        common = other._position(bucket, _storedHash(element), element.first) != bucket.size();
+                    }
+                    else
+                    {
+                        size_t pos;
+                        common = other._locate(_entryHash(element), element.first, pos) != other._bucketCount();
+                    }
+                    if (common == keepCommon)
+                    {
+                        result._map[i].push_back(element);
+                        keptInChunk++;
+                    }
+                }
+            }
+            kept.fetch_add(keptInChunk, std::memory_order_relaxed);
+        });
+        result.currNumOfElements = (int) kept.load();
+        result._shrinkToLoad();
+        return result;
+    }
+
+    /**
+     * check if two buckets hold the same elements. small buckets are compared element by element, larger ones are
+     * ordered by hash code first, so only elements with equal hash codes are compared.
+     * @param bucket - a bucket of this map.
+     * @param other - a bucket of another map.
+     * @param left - storage for the hash codes of bucket, reused between calls.
+     * @param right - storage for the hash codes of other, reused between calls.
+     * @return - true if the buckets hold the same elements, false otherwise.
+     */
+    bool _bucketEquals(const Bucket& bucket, const Bucket& other, vector<pair<size_t, const Entry*>>& left,
+                       vector<pair<size_t, const Entry*>>& right) const
+    {
+        if (bucket.size() != other.size())
+        {
+            return false;
+        }
+        auto sameElement = [this](const Entry& a, const Entry& b)
+        {
+            return _keyEqual(a.first, b.first) && a.second == b.second;
+        };
+        if (bucket.size() < kSortedCompare)
+        {
+            return std::is_permutation(bucket.begin(), bucket.end(), other.begin(), sameElement);
+        }
+        left.clear();
+        right.clear();
+        for (const Entry& element : bucket)
+        {
+            left.emplace_back(_entryHash(element), &element);
+        }
+        for (const Entry& element : other)
+        {
+            right.emplace_back(_entryHash(element), &element);
+        }
+        auto byHash = [](const pair<size_t, const Entry*>& a, const pair<size_t, const Entry*>& b)
+        {
+            return a.first < b.first;
+        };
+        std::sort(left.begin(), left.end(), byHash);
+        std::sort(right.begin(), right.end(), byHash);
+        size_t begin = 0;
+        while (begin < left.size())
+        {
+            size_t hash = left[begin].first;
+            size_t end = begin + 1;
+            while (end < left.size() && left[end].first == hash)
+            {
+                end++;
+            }
+            if (right[begin].first != hash || right[end - 1].first != hash ||
+                (end < right.size() && right[end].first == hash))
+            {
+                return false;
+            }
+            if (!std::is_permutation(left.begin() + begin, left.begin() + end, right.begin() + begin,
+                                     [&sameElement](const pair<size_t, const Entry*>& a,
+                                                    const pair<size_t, const Entry*>& b)
+            {
+                return sameElement(*a.second, *b.second);
+            }))
+            {
+                return false;
+            }
+            begin = end;
+        }
+        return true;
     }
 
 public:
@@ -148,17 +1284,27 @@ public:
     class const_iterator: public std::iterator<std::forward_iterator_tag, pair<KeyT, ValueT>>
     {
     private:
-        const HashMap<KeyT, ValueT>* _map;
-        typename vector<pair<KeyT, ValueT>>::const_iterator _ptr;
-        int _bucket;
-        int _elements_counter;
+        const HashMap* _map;
+        size_t _bucket;
+        size_t _pos;
 
+        /**
+         * move forward to the first element at or after the current position.
+         */
+        void _skipEmpty()
+        {
+            while (_bucket < _map->_bucketCount() && _pos == _map->_bucketSize(_bucket))
+            {
+                _bucket++;
+                _pos = 0;
+            }
+        }
 
     public:
         typedef const_iterator self_type;
         typedef pair<KeyT, ValueT> value_type;
-        typedef pair<KeyT, ValueT>& reference;
-        typedef typename vector<pair<KeyT, ValueT>>::const_iterator pointer;
+        typedef const pair<KeyT, ValueT>& reference;
+        typedef const pair<KeyT, ValueT>* pointer;
         typedef std::forward_iterator_tag iterator_category;
         typedef int difference_type;
 
@@ -166,7 +1312,7 @@ public:
         /**
          * default constructor.
          */
-        const_iterator():_map(nullptr), _ptr(nullptr), _bucket(0), _elements_counter(0)
+        const_iterator():_map(nullptr), _bucket(0), _pos(0)
         {
 
         }
@@ -174,119 +1320,69 @@ public:
         /**
          * a constructor to construct from an hash map.
          * @param hashMap - hash map to construct from.
+         * @param isEnd - true for an iterator past the last element, false for the first element.
          */
-        explicit const_iterator(const HashMap<KeyT, ValueT>* hashMap, bool isEnd):_map(hashMap), _ptr(nullptr), _bucket(0), _elements_counter(0)
+        explicit const_iterator(const HashMap* hashMap, bool isEnd):_map(hashMap), _bucket(0), _pos(0)
         {
             if (isEnd)
             {
-                _ptr = _map->_map[_map->capacity() - 1].end();
-                _elements_counter = _map->size() - 1;
+                _bucket = _map->_bucketCount();
             }
             else
             {
-                _ptr = _map->_map[0].begin();
-                for (size_t i = 0; i < hashMap->capacity(); ++i)
-                {
-                    if (!_map->_map[i].empty())
-                    {
-                        _ptr = _map->_map[i].begin();
-                        _bucket = i;
-                        break;
-                    }
-                }
+                _skipEmpty();
             }
         }
 
         /**
-         * copy constructor.
-         * @param other - other iterator to copy from.
+         * a constructor to construct from a position in a bucket.
+         * @param hashMap - hash map to construct from.
+         * @param bucket - index of the bucket.
+         * @param pos - index of the element in the bucket.
          */
-        const_iterator(const const_iterator& other):const_iterator()
+        const_iterator(const HashMap* hashMap, size_t bucket, size_t pos):_map(hashMap), _bucket(bucket),
+                                                                                          _pos(pos)
         {
-            _map = other._map;
-            _ptr = other._ptr;
-            _bucket = other._bucket;
-            _elements_counter = other._elements_counter;
+
         }
 
         /**
          * dereference operator.
          * @return - pair<KeyT, ValueT>.
          */
-        value_type operator *()
+        reference operator *() const
         {
-            return *_ptr;
+            return _map->_bucketAt(_bucket)[_pos];
         }
 
         /**
          * pointer operator.
-         * @return - the iterator currently held.
+         * @return - pointer to the current pair.
          */
-        const pair<KeyT, ValueT>* operator ->()
-        {
-            return _ptr.operator->();
-        }
-
-        const_iterator& operator =(const self_type& other)
+        pointer operator ->() const
         {
-            this->_map = other._map;
-            _ptr = other._ptr;
-            _bucket = other._bucket;
-            _elements_counter = other._elements_counter;
+            return &_map->_bucketAt(_bucket)[_pos];
         }
 
         /**
          * forwarding operator.
-         * @return - self.
+         * @return - self after moving.
          */
-        self_type operator ++(int)
+        self_type& operator ++()
         {
-            ++_ptr;
-            if (_elements_counter == _map->size() - 1) /////TODO:check counter
-            {
-                _ptr = _map->_map[_map->capacity() - 1].end();
-                return *this;
-            }
-            if (_ptr == _map->_map[_bucket].end() && _bucket < _map->capacity() - 1)
-            {
-                _bucket++;
-                while (_map->_map[_bucket].empty() && _bucket < _map->capacity() - 1)
-                {
-                    _bucket++;
-                }
-                _ptr = _map->_map[_bucket].begin();
-                _elements_counter++;
-                return *this;
-            }
-            _elements_counter++;
+            _pos++;
+            _skipEmpty();
             return *this;
         }
 
         /**
          * forwarding operator.
-         * @return - self.
+         * @return - a copy of self before moving.
          */
-        self_type operator ++()
+        self_type operator ++(int)
         {
             self_type toReturn = *this;
-            ++_ptr;
-            if (_elements_counter == _map->size() - 1) /////TODO:check counter
-            {
-                _ptr = _map->_map[_map->capacity() - 1].end();
-                return toReturn;
-            }
-            if (_ptr == _map->_map[_bucket].end() && _bucket < _map->capacity() - 1)
-            {
-                _bucket++;
-                while (_map->_map[_bucket].empty() && _bucket < _map->capacity() - 1)
-                {
-                    _bucket++;
-                }
-                _ptr = _map->_map[_bucket].begin();
-                _elements_counter++;
-                return toReturn;
-            }
-            _elements_counter++;
+            ++(*this);
             return toReturn;
         }
 
@@ -295,9 +1391,9 @@ public:
          * @param other - other iterator for comparison.
          * @return - true if equal, false else.
          */
-        bool operator ==(const self_type& other)
+        bool operator ==(const self_type& other) const
         {
-            return _ptr == other._ptr && _map == other._map;
+            return _bucket == other._bucket && _pos == other._pos && _map == other._map;
         }
 
         /**
@@ -305,7 +1401,7 @@ public:
          * @param other - other iterator for comparison.
          * @return - true if different, false else.
          */
-        bool operator !=(const self_type& other)
+        bool operator !=(const self_type& other) const
         {
             return !(this->operator==(other));
         }
@@ -314,33 +1410,198 @@ public:
 
     typedef const_iterator iterator;
 
+    /**
+     * an element extracted from a map, see extract. it owns the key-value pair along with the hash code of the key,
+     * so inserting it into a map of the same type calls no hash function. the key cannot be changed, since that
+     * would invalidate the hash code.
+     */
+    class node_type
+    {
+    private:
+        friend class HashMap;
+
+        typename std::aligned_storage<sizeof(pair<KeyT, ValueT>), alignof(pair<KeyT, ValueT>)>::type _storage;
+        size_t _hash{};
+        bool _engaged = false;
+
+        node_type(size_t hash, pair<KeyT, ValueT>&& element): _hash(hash), _engaged(true)
+        {
+            new (&_storage) pair<KeyT, ValueT>(std::move(element));
+        }
+
+        pair<KeyT, ValueT>& _element()
+        {
+            return *reinterpret_cast<pair<KeyT, ValueT>*>(&_storage);
+        }
+
+        const pair<KeyT, ValueT>& _element() const
+        {
+            return *reinterpret_cast<const pair<KeyT, ValueT>*>(&_storage);
+        }
+
+        /**
+         * destroy the element, if there is one.
+         */
+        void _reset()
+        {
+            if (_engaged)
+            {
+                _element().~pair();
+                _engaged = false;
+            }
+        }
+
+    public:
+        /**
+         * a constructor of an empty node.
+         */
+        node_type()
+        {
+
+        }
+
+        node_type(node_type&& other): _hash(other._hash), _engaged(other._engaged)
+        {
+            if (_engaged)
+            {
+                new (&_storage) pair<KeyT, ValueT>(std::move(other._element()));
+                other._reset();
+            }
+        }
+
+        node_type& operator =(node_type&& other)
+        {
+            if (this != &other)
+            {
+                _reset();
+                if (other._engaged)
+                {
+                    new (&_storage) pair<KeyT, ValueT>(std::move(other._element()));
+                    _hash = other._hash;
+                    _engaged = true;
+                    other._reset();
+                }
+            }
+            return *this;
+        }
+
+        ~node_type()
+        {
+            _reset();
+        }
+
+        /**
+         * check if the node holds no element.
+         * @return - true or false.
+         */
+        bool empty() const
+        {
+            return !_engaged;
+        }
+
+        explicit operator bool() const
+        {
+            return _engaged;
+        }
+
+        /**
+         * get the key of the element, the node must not be empty.
+         * @return - the key.
+         */
+        const KeyT& key() const
+        {
+            return _element().first;
+        }
+
+        /**
+         * get the value of the element, the node must not be empty.
+         * @return - the value.
+         */
+        ValueT& mapped()
+        {
+            return _element().second;
+        }
+
+        const ValueT& mapped() const
+        {
+            return _element().second;
+        }
+    };
+
     /**
      * a default constructor.
      */
-    HashMap(): upperThreshold(0.75), lowerThreshold(0.25), maxNumOfElements(16), currNumOfElements(0)
+    HashMap(): HashMap(Hash())
+    {
+
+    }
+
+    /**
+     * a constructor with given hash and key equality functions.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     * @param allocator - allocator of the buckets.
+     */
+    explicit HashMap(const Hash& hash, const KeyEqual& keyEqual = KeyEqual(), const Allocator& allocator = Allocator()):
+            HashMap(0.75, 0.25, hash, keyEqual, allocator)
+    {
+
+    }
+
+    /**
+     * a constructor with a given allocator.
+     * @param allocator - allocator of the buckets.
+     */
+    explicit HashMap(const Allocator& allocator): HashMap(0.75, 0.25, Hash(), KeyEqual(), allocator)
+    {
+
+    }
+
+    /**
+     * a constructor with given load thresholds.
+     * @param upperLoadFactor - load factor above which the table is increased.
+     * @param lowerLoadFactor - load factor below which the table is decreased, less than half of upperLoadFactor.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     * @param allocator - allocator of the buckets.
+     */
+    HashMap(double upperLoadFactor, double lowerLoadFactor, const Hash& hash = Hash(),
+            const KeyEqual& keyEqual = KeyEqual(), const Allocator& allocator = Allocator()): _hasher(hash),
+            _keyEqual(keyEqual), _allocator(allocator), upperThreshold(upperLoadFactor),
+            lowerThreshold(lowerLoadFactor), maxNumOfElements(16), currNumOfElements(0)
     {
-        _map = new vector<pair<KeyT, ValueT>>[16]();
+        _checkThresholds(upperLoadFactor, lowerLoadFactor);
+        _map = _newBuckets(16);
     }
 
     /**
      * a copy constructor.
      * @param other - other hashmap to copy from.
      */
-    HashMap(const HashMap<KeyT, ValueT>& other):HashMap()
+    HashMap(const HashMap& other):HashMap(other.upperThreshold, other.lowerThreshold, other._hasher,
+                                          other._keyEqual,
+                                          std::allocator_traits<Allocator>::select_on_container_copy_construction(
+                                                  other._allocator))
     {
+        _deleteBuckets(_map, capacity());
+        _map = nullptr;
+        _autoShrink = other._autoShrink;
+        _reservedCapacity = other._reservedCapacity;
         maxNumOfElements = other.maxNumOfElements;
         currNumOfElements = other.currNumOfElements;
-        delete [] _map;
-        _map = nullptr;
-        _map = new vector<pair<KeyT, ValueT>>[capacity()]();
-        for (size_t i = 0; i < other.capacity(); ++i)
-        {
-            vector<pair<KeyT, ValueT>> toCopy = other._map[i];
-            for (pair<KeyT, ValueT> pair: toCopy)
-            {
-                _map[i].push_back(pair);
-            }
-        }
+        _rehashStep = other._rehashStep;
+        _pool = other._pool;
+        _map = _newBuckets(capacity());
+        _copyElements(other, _pool);
+    }
+
+    /**
+     * a move constructor. other is left as an empty map.
+     * @param other - other hashmap to move from.
+     */
+    HashMap(HashMap&& other):HashMap()
+    {
+        _swap(other);
     }
 
     /**
@@ -351,43 +1612,105 @@ public:
      * @param keysEnd - end of keys vector.
      * @param valuesBegin - beginning of values vector.
      * @param valuesEnd - end of values vector.
+     * @param pool - threads that build the _map from random access ranges and that later resize and copy it, see
+     * set_thread_pool, or nullptr.
      */
-    template<typename KeysInputIterator, typename ValuesInputIterator> ///// TODO:continue func.
-    HashMap(const KeysInputIterator keysBegin, const KeysInputIterator keysEnd, const ValuesInputIterator valuesBegin, const ValuesInputIterator valuesEnd): HashMap()
+    template<typename KeysInputIterator, typename ValuesInputIterator>
+    HashMap(const KeysInputIterator keysBegin, const KeysInputIterator keysEnd, const ValuesInputIterator valuesBegin, const ValuesInputIterator valuesEnd,
+            ThreadPool* pool = nullptr): HashMap()
     {
-        int sizesEqual = _areSizesEqual(keysBegin, keysEnd, valuesBegin, valuesEnd);
-        if (sizesEqual < 0)
+        _pool = pool;
+        typedef typename std::iterator_traits<KeysInputIterator>::iterator_category KeysCategory;
+        typedef typename std::iterator_traits<ValuesInputIterator>::iterator_category ValuesCategory;
+        _build(keysBegin, keysEnd, valuesBegin, valuesEnd, std::integral_constant<bool,
+               std::is_base_of<std::random_access_iterator_tag, KeysCategory>::value &&
+               std::is_base_of<std::random_access_iterator_tag, ValuesCategory>::value>());
+    }
+
+    /**
+     * delete sand frees the _map.
+     */
+    ~HashMap()
+    {
+        _deleteMaps();
+    }
+
+    /**
+     * copy the map, splitting the buckets between the threads of a pool. the copy uses the pool of this map for its
+     * own resizes, as a copy made by the copy constructor does.
+     * @param pool - the pool, or nullptr to copy on the calling thread.
+     * @return - the copy.
+     */
+    HashMap clone(ThreadPool* pool) const
+    {
+        HashMap result(upperThreshold, lowerThreshold, _hasher, _keyEqual,
+                       std::allocator_traits<Allocator>::select_on_container_copy_construction(_allocator));
+        result._deleteBuckets(result._map, result.capacity());
+        result._map = nullptr;
+        result._autoShrink = _autoShrink;
+        result._reservedCapacity = _reservedCapacity;
+        result.maxNumOfElements = maxNumOfElements;
+        result.currNumOfElements = currNumOfElements;
+        result._rehashStep = _rehashStep;
+        result._pool = _pool;
+        result._map = result._newBuckets(capacity());
+        result._copyElements(*this, pool);
+        return result;
+    }
+
+    /**
+     * Compares the contents of two maps, splitting the buckets between the threads of a pool. as with operator==,
+     * maps of different capacities are never equal.
+     * @param other - the map to compare with.
+     * @param pool - the pool, or nullptr to compare on the calling thread.
+     * @return - true if the contents of the maps are equal, false otherwise.
+     */
+    bool equals(const HashMap& other, ThreadPool* pool) const
+    {
+        if (size() != other.size() || capacity() != other.capacity())
         {
-            delete [] _map;
-            _map = nullptr;
-            throw std::length_error("given vectors are of different size.");
+            return false;
+        }
+        if (rehashing() || other.rehashing())
+        {
+            for (size_t index = 0; index < _bucketCount(); ++index)
+            {
+                const Bucket& bucket = _bucketAt(index);
+                for (size_t i = 0; i < _bucketSize(index); ++i)
+                {
+                    size_t pos;
+                    size_t found = other._locate(_entryHash(bucket[i]), bucket[i].first, pos);
+                    if (found == other._bucketCount() || !(other._bucketAt(found)[pos].second == bucket[i].second))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
         }
-        auto key = keysBegin;
-        auto value = valuesBegin;
-        while (key != keysEnd && value != valuesEnd)
+        std::atomic<bool> equal(true);
+        _forEachChunk(pool, capacity(), [this, &other, &equal](size_t begin, size_t end)
         {
-            KeyT keyT = *key;
-            if (contains_key(keyT))
-            {
-                this->operator[](keyT) = *value;
-            }
-            else
+            vector<pair<size_t, const Entry*>> left;
+            vector<pair<size_t, const Entry*>> right;
+            for (size_t i = begin; i < end && equal.load(std::memory_order_relaxed); ++i)
             {
-                insert(keyT, *value);
+                if (!_bucketEquals(_map[i], other._map[i], left, right))
+                {
+                    equal.store(false, std::memory_order_relaxed);
+                }
             }
-            key++;
-            value++;
-        }
-
+        });
+        return equal.load(std::memory_order_relaxed);
     }
 
     /**
-     * delete sand frees the _map.
+     * get the allocator of the _map.
+     * @return - a copy of the allocator.
      */
-    ~HashMap()
+    Allocator get_allocator() const
     {
-        delete [] _map;
-        _map = nullptr;
+        return _allocator;
     }
 
     /**
@@ -425,19 +1748,88 @@ public:
      */
     bool insert(const KeyT& key, const ValueT& value)
     {
-        if (contains_key(key))
-        {
-            return false;
-        }
-        pair<KeyT, ValueT> pair(key, value);
-        int index = _clamp(std::hash<KeyT>{}(pair.first), capacity());
-        _map[index].push_back(pair);
-        currNumOfElements++;
-        if (load_factor() > this->upperThreshold)
-        {
-            _increaseMapSize();
-        }
-        return true;
+        return _insert(key, value);
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * the key and value are moved into the container.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(KeyT&& key, ValueT&& value)
+    {
+        return _insert(std::move(key), std::move(value));
+    }
+
+    /**
+     * Inserts a new element constructed in place from the given arguments, if the container doesn't already contain
+     * an element with an equivalent key. the element is constructed before the lookup, use try_emplace to avoid
+     * constructing the value when the key exists.
+     * @tparam Args - types of the arguments to construct the element from.
+     * @param args - arguments to construct a pair<KeyT, ValueT> from.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    template<typename... Args>
+    bool emplace(Args&&... args)
+    {
+        pair<KeyT, ValueT> element(std::forward<Args>(args)...);
+        return _insert(std::move(element.first), std::move(element.second));
+    }
+
+    /**
+     * Inserts a new element with the given key and a value constructed in place from the given arguments, if the
+     * container doesn't already contain an element with an equivalent key. nothing is constructed on a hit.
+     * @tparam Args - types of the arguments to construct the value from.
+     * @param key - key to insert.
+     * @param args - arguments to construct the value from.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    template<typename... Args>
+    bool try_emplace(const KeyT& key, Args&&... args)
+    {
+        return _tryEmplace(key, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Inserts a new element with the given key and a value constructed in place from the given arguments, if the
+     * container doesn't already contain an element with an equivalent key. nothing is moved on a hit.
+     * @tparam Args - types of the arguments to construct the value from.
+     * @param key - key to insert.
+     * @param args - arguments to construct the value from.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    template<typename... Args>
+    bool try_emplace(KeyT&& key, Args&&... args)
+    {
+        return _tryEmplace(std::move(key), std::forward<Args>(args)...);
+    }
+
+    /**
+     * Assigns value to the element with the given key, or inserts a new element if there is no such key.
+     * @tparam V - type of the value.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the insertion took place, false if the assignment took place.
+     */
+    template<typename V>
+    bool insert_or_assign(const KeyT& key, V&& value)
+    {
+        return _insertOrAssign(key, std::forward<V>(value));
+    }
+
+    /**
+     * Assigns value to the element with the given key, or inserts a new element if there is no such key.
+     * @tparam V - type of the value.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the insertion took place, false if the assignment took place.
+     */
+    template<typename V>
+    bool insert_or_assign(KeyT&& key, V&& value)
+    {
+        return _insertOrAssign(std::move(key), std::forward<V>(value));
     }
 
     /**
@@ -447,16 +1839,23 @@ public:
      */
     bool contains_key(const KeyT& key) const
     {
-        int index = _clamp(std::hash<KeyT>{}(key), capacity());
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        for (pair<KeyT, ValueT> pair: bucket)
+        return find(key) != end();
+    }
+
+    /**
+     * Finds an element with key equivalent to key.
+     * @param key - key value of the element to search for.
+     * @return - an iterator to the requested element, or end() if there is no such element.
+     */
+    iterator find(const KeyT& key) const
+    {
+        size_t pos;
+        size_t index = _locate(_hasher(key), key, pos);
+        if (index == _bucketCount())
         {
-            if (pair.first == key)
-            {
-                return true;
-            }
+            return end();
         }
-        return false;
+        return const_iterator(this, index, pos);
     }
 
     /**
@@ -467,18 +1866,13 @@ public:
      */
     ValueT& at(const KeyT& key)
     {
-        if (!contains_key(key))
+        size_t pos;
+        size_t index = _locate(_hasher(key), key, pos);
+        if (index == _bucketCount())
         {
             throw std::out_of_range("Hash _map does not contain given key.");
         }
-        int index = _clamp(std::hash<KeyT>{}(key), capacity());
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        auto it = bucket.begin();
-        while (it->first != key)
-        {
-            it++;
-        }
-        return it->second;
+        return _bucketAt(index)[pos].second;
     }
 
     /**
@@ -489,18 +1883,81 @@ public:
      */
     const ValueT& at(const KeyT& key) const
     {
-        if (!contains_key(key))
+        size_t pos;
+        size_t index = _locate(_hasher(key), key, pos);
+        if (index == _bucketCount())
         {
             throw std::out_of_range("Hash _map does not contain the given key.");
         }
-        int index = _clamp(std::hash<KeyT>{}(key), capacity());
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        auto it = bucket.begin();
-        while (it->first != key)
+        return _bucketAt(index)[pos].second;
+    }
+
+    /**
+     * Finds the elements of a batch of keys. the buckets of a group of keys are prefetched before any key is compared,
+     * which hides most of the memory latency when the map is larger than the cache.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives iterators.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives an iterator to the element of every key, or end() if there is no such element, in the
+     * order of the keys.
+     * @return - the output iterator past the last iterator written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator find_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index, size_t pos)
         {
-            it ++;
-        }
-        return it->second;
+            *out++ = index == _bucketCount() ? end() : const_iterator(this, index, pos);
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
+    }
+
+    /**
+     * checks for every key of a batch if the container contains an element with that key, prefetching as find_many
+     * does.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives bools.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives true or false for every key, in the order of the keys.
+     * @return - the output iterator past the last value written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator contains_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index, size_t)
+        {
+            *out++ = index != _bucketCount();
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
+    }
+
+    /**
+     * copies the mapped values of a batch of keys, prefetching as find_many does. If one of the keys is not in the
+     * map, an exception of type std::out_of_range is thrown, after the values of the keys before it were written.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives values.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives the mapped value of every key, in the order of the keys.
+     * @return - the output iterator past the last value written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator at_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index, size_t pos)
+        {
+            if (index == _bucketCount())
+            {
+                throw std::out_of_range("Hash _map does not contain the given key.");
+            }
+            *out++ = _bucketAt(index)[pos].second;
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
     }
 
     /**
@@ -510,26 +1967,334 @@ public:
      */
     bool erase(const KeyT& key)
     {
-        int index = _clamp(std::hash<KeyT>{}(key), capacity());
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        if (!contains_key(key))
+        size_t pos;
+        size_t index = _locate(_hasher(key), key, pos);
+        if (index == _bucketCount())
         {
             return false;
         }
-        auto it = bucket.begin();
-        while (it->first != key)
+        _eraseAt(index, pos);
+        return true;
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key and returns it in a node, moving the pair
+     * out of its bucket instead of copying it.
+     * @param key - key value of the element to extract.
+     * @return - a node holding the element, or an empty node if there is no such element.
+     */
+    node_type extract(const KeyT& key)
+    {
+        size_t hash = _hasher(key);
+        size_t pos;
+        size_t index = _locate(hash, key, pos);
+        if (index == _bucketCount())
+        {
+            return node_type();
+        }
+        node_type node(hash, std::move(_bucketAt(index)[pos]));
+        _eraseAt(index, pos);
+        return node;
+    }
+
+    /**
+     * Inserts the element of a node, if the container doesn't already contain an element with an equivalent key. the
+     * hash code kept in the node is used, so the node must come from a map with the same hash function.
+     * @param node - the node, it is left empty if the insertion took place and unchanged otherwise.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(node_type&& node)
+    {
+        if (node.empty())
         {
-            it ++;
+            return false;
         }
-        bucket.erase(it);
-        this->currNumOfElements--;
-        if (capacity() > 1 && load_factor() < this->lowerThreshold)
+        size_t pos;
+        if (_locate(node._hash, node.key(), pos) != _bucketCount())
         {
-            _decreaseMapSize();
+            return false;
         }
+        _emplaceNew(node._hash, std::move(node._element()));
+        node._reset();
         return true;
     }
 
+    /**
+     * Moves every element of source whose key is not in this map into this map. elements whose key is already here
+     * stay in source. the capacity is increased once for all elements up front, every element is located by its
+     * stored hash code when the hash is stored, and the pairs are moved rather than copied. source keeps its
+     * capacity. both maps must use the same hash function and key equality.
+     * @param source - the map to take the elements from.
+     */
+    void merge(HashMap& source)
+    {
+        if (&source == this)
+        {
+            return;
+        }
+        source._finishRehash();
+        _grow(size() + source.size());
+        for (size_t i = 0; i < source.capacity(); ++i)
+        {
+            Bucket& bucket = source._map[i];
+            size_t pos = 0;
+            while (pos < bucket.size())
+            {
+                size_t hash = source._entryHash(bucket[pos]);
+                size_t found;
+                if (_locate(hash, bucket[pos].first, found) != _bucketCount())
+                {
+                    pos++;
+                    continue;
+                }
+                _emplaceNew(hash, std::move(static_cast<pair<KeyT, ValueT>&>(bucket[pos])));
+                bucket.erase(bucket.begin() + pos);
+                source.currNumOfElements--;
+            }
+        }
+    }
+
+    /**
+     * get the elements of this map whose key is also in another map. the buckets are split between the threads of a
+     * pool, and when the maps have the same capacity every bucket is only compared with the bucket of the same
+     * index in other, so no key is hashed. both maps must use the same hash function and key equality.
+     * @param other - the other map.
+     * @param pool - the pool, or nullptr to work on the calling thread.
+     * @return - a map of those elements, with the values of this map.
+     */
+    HashMap intersect(const HashMap& other, ThreadPool* pool = nullptr) const
+    {
+        return _filter(other, true, pool);
+    }
+
+    /**
+     * get the elements of this map whose key is not in another map, see intersect.
+     * @param other - the other map.
+     * @param pool - the pool, or nullptr to work on the calling thread.
+     * @return - a map of those elements.
+     */
+    HashMap difference(const HashMap& other, ThreadPool* pool = nullptr) const
+    {
+        return _filter(other, false, pool);
+    }
+
+    /**
+     * add the elements of another map to this one, combining the values of keys that are in both. the map is grown
+     * once up front, then every bucket gathers its elements from the buckets of other that map to it, split
+     * between the threads of a pool. when other has fewer buckets and the hash codes are not stored, or other is in
+     * the middle of an incremental rehash, the elements of other are inserted one by one instead. both maps must use
+     * the same hash function and key equality.
+     * @tparam Combiner - type of the combiner, callable with ValueT& and const ValueT&.
+     * @param other - the map to add, it is not modified.
+     * @param combine - called with the value in this map and the value in other when a key is in both. with a pool
+     * it is called from several threads at once but never for the same key.
+     * @param pool - the pool, or nullptr to work on the calling thread.
+     */
+    template<typename Combiner>
+    void union_with(const HashMap& other, Combiner combine, ThreadPool* pool = nullptr)
+    {
+        if (&other == this)
+        {
+            HashMap copy(other);
+            union_with(copy, combine, pool);
+            return;
+        }
+        _finishRehash();
+        _grow(std::max(size(), other.size()));
+        if (other.rehashing() || (!StoreHash && other.capacity() < capacity()))
+        {
+            for (const pair<KeyT, ValueT>& element : other)
+            {
+                size_t hash = _hasher(element.first);
+                size_t pos;
+                size_t index = _locate(hash, element.first, pos);
+                if (index == _bucketCount())
+                {
+                    _emplaceNew(hash, element);
+                }
+                else
+                {
+                    combine(_bucketAt(index)[pos].second, element.second);
+                }
+            }
+            return;
+        }
+        const HashMap* sources[] = {&other};
+        _combine(sources, 1, combine, pool);
+    }
+
+    /**
+     * Removes every element that satisfies a predicate. every bucket is compacted in a single pass, and the _map is
+     * shrunk at most once, after all buckets were compacted, to the capacity repeated removals would have left it at.
+     * @tparam Predicate - type of the predicate, callable with const pair<KeyT, ValueT>&.
+     * @param predicate - returns true for the elements to remove. with a pool it is called from several threads at
+     * once, for different elements.
+     * @param pool - threads to split the buckets between, or nullptr to compact them on the calling thread.
+     * @return - the number of elements removed.
+     */
+    template<typename Predicate>
+    size_t erase_if(Predicate predicate, ThreadPool* pool = nullptr)
+    {
+        _finishRehash();
+        std::atomic<size_t> removed(0);
+        _forEachChunk(pool, capacity(), [this, &predicate, &removed](size_t begin, size_t end)
+        {
+            size_t removedHere = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                Bucket& bucket = _map[i];
+                auto kept = std::remove_if(bucket.begin(), bucket.end(), [&predicate](const Entry& element)
+                {
+                    return predicate(static_cast<const pair<KeyT, ValueT>&>(element));
+                });
+                removedHere += bucket.end() - kept;
+                bucket.erase(kept, bucket.end());
+            }
+            removed.fetch_add(removedHere, std::memory_order_relaxed);
+        });
+        size_t count = removed.load(std::memory_order_relaxed);
+        currNumOfElements -= (int) count;
+        _shrinkToLoad();
+        return count;
+    }
+
+    /**
+     * Removes every element that does not satisfy a predicate, see erase_if.
+     * @tparam Predicate - type of the predicate, callable with const pair<KeyT, ValueT>&.
+     * @param predicate - returns true for the elements to keep.
+     * @param pool - threads to split the buckets between, or nullptr.
+     * @return - the number of elements removed.
+     */
+    template<typename Predicate>
+    size_t retain(Predicate predicate, ThreadPool* pool = nullptr)
+    {
+        return erase_if([&predicate](const pair<KeyT, ValueT>& element)
+        {
+            return !predicate(element);
+        }, pool);
+    }
+
+    /**
+     * get the load factor above which the table is increased.
+     * @return - the upper threshold.
+     */
+    double upper_threshold() const
+    {
+        return upperThreshold;
+    }
+
+    /**
+     * get the load factor below which the table is decreased.
+     * @return - the lower threshold.
+     */
+    double lower_threshold() const
+    {
+        return lowerThreshold;
+    }
+
+    /**
+     * Sets the load factors that trigger resizing. the table is increased right away if its load exceeds the new
+     * upper threshold.
+     * @param upperLoadFactor - load factor above which the table is increased.
+     * @param lowerLoadFactor - load factor below which the table is decreased, less than half of upperLoadFactor.
+     */
+    void set_load_thresholds(double upperLoadFactor, double lowerLoadFactor)
+    {
+        _checkThresholds(upperLoadFactor, lowerLoadFactor);
+        this->upperThreshold = upperLoadFactor;
+        this->lowerThreshold = lowerLoadFactor;
+        if (load_factor() > this->upperThreshold)
+        {
+            _rehashTo(_capacityFor(size()));
+        }
+    }
+
+    /**
+     * Turns automatic decreasing of the table on erase on or off. when it is off the table only shrinks through
+     * rehash() and shrink_to_fit().
+     * @param autoShrink - whether erase may decrease the table.
+     */
+    void set_auto_shrink(bool autoShrink)
+    {
+        _autoShrink = autoShrink;
+    }
+
+    /**
+     * Sets the capacity to the smallest power of two that is at least numOfBuckets and holds all current elements
+     * without exceeding the upper threshold. drops the floor set by reserve.
+     * @param numOfBuckets - requested number of buckets.
+     */
+    void rehash(size_t numOfBuckets)
+    {
+        _reservedCapacity = 1;
+        size_t updatedCap = _capacityFor(size());
+        while (updatedCap < numOfBuckets)
+        {
+            updatedCap *= 2;
+        }
+        _rehashTo(updatedCap);
+    }
+
+    /**
+     * Increases the capacity so that numOfElements elements fit without any further resize. never decreases it, and
+     * erase does not decrease it below that capacity either, until the next reserve, rehash() or shrink_to_fit().
+     * @param numOfElements - number of elements the _map should hold.
+     */
+    void reserve(size_t numOfElements)
+    {
+        _reservedCapacity = _capacityFor(numOfElements);
+        _grow(numOfElements);
+    }
+
+    /**
+     * Decreases the capacity to the smallest one that holds the current elements without exceeding the upper
+     * threshold.
+     */
+    void shrink_to_fit()
+    {
+        rehash(0);
+    }
+
+    /**
+     * Turns incremental rehashing on or off. when it is on, a resize only allocates the new bucket array, and every
+     * later insertion or removal moves some old buckets into it, constructing the new buckets they feed as it goes,
+     * so no single operation pays for the whole _map. the number of buckets moved per operation is at least
+     * bucketsPerStep, and large enough that the rehash ends before the _map has to grow again, so the _map never
+     * waits for a rehash to finish. lookups check both bucket arrays until all elements were moved, but do not move
+     * any, since that would invalidate the references they return.
+     * @param bucketsPerStep - least number of old buckets moved per operation, 0 to rebuild the whole _map on resize.
+     */
+    void set_incremental_rehash(size_t bucketsPerStep)
+    {
+        _rehashStep = bucketsPerStep;
+        _migrationStep = std::max(_migrationStep, _rehashStep);
+        if (_rehashStep == 0)
+        {
+            _finishRehash();
+        }
+    }
+
+    /**
+     * Sets the threads that split the work of resizing and copying maps with many buckets. every worker takes a
+     * range of source buckets, and since they write disjoint buckets no locking is needed. resizes to a capacity that
+     * is neither double nor half of the current one, and incremental rehash steps, still run on the calling thread.
+     * the allocator must be thread safe, which PoolAllocator is not. copies of the _map use the same pool.
+     * @param pool - the pool, it must outlive its use by the _map, or nullptr to do all work on the calling thread.
+     */
+    void set_thread_pool(ThreadPool* pool)
+    {
+        _pool = pool;
+    }
+
+    /**
+     * check whether an incremental rehash is in progress.
+     * @return - true if some elements are still in the buckets of the previous capacity.
+     */
+    bool rehashing() const
+    {
+        return _oldMap != nullptr;
+    }
+
     /**
      * Returns the average number of elements per bucket.
      * @return - Average number of elements per bucket.
@@ -546,49 +2311,65 @@ public:
      */
     size_t bucket_size(const KeyT& key) const
     {
-
-        if (!contains_key(key))
+        size_t pos;
+        size_t index = _locate(_hasher(key), key, pos);
+        if (index == _bucketCount())
         {
             throw std::out_of_range("Hash map does not contain the given key.");
         }
-        int index = _clamp(std::hash<KeyT>{}(key), capacity());
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        return bucket.size();
+        return _bucketAt(index).size();
     }
 
     /**
-     * get the index of a bucket that contains a given key.
+     * get the index of a bucket that contains a given key. while an incremental rehash is in progress a key that was
+     * not moved yet is still in a bucket of the previous capacity, and its index is capacity() plus the index of that
+     * bucket, so the index always names the bucket whose size bucket_size reports.
      * @param key - a key to find the bucket.
-     * @return - size of the bucket containing the key.
+     * @return - index of the bucket containing the key.
      */
     size_t bucket_index(const KeyT& key) const
     {
-        if (!contains_key(key))
+        size_t pos;
+        size_t index = _locate(_hasher(key), key, pos);
+        if (index == _bucketCount())
         {
             throw std::out_of_range("Hash _map does not contain the given key.");
         }
-        int index = _clamp(std::hash<KeyT>{}(key), capacity());
         return index;
     }
 
-    HashMap<KeyT, ValueT>& operator =(const HashMap<KeyT, ValueT> & other)
+    HashMap& operator =(const HashMap & other)
     {
         if (this == &other)
         {
             return *this;
         }
+        _deleteMaps();
+        if (std::allocator_traits<Allocator>::propagate_on_container_copy_assignment::value)
+        {
+            this->_allocator = other._allocator;
+        }
+        this->_hasher = other._hasher;
+        this->_keyEqual = other._keyEqual;
+        this->upperThreshold = other.upperThreshold;
+        this->lowerThreshold = other.lowerThreshold;
+        this->_autoShrink = other._autoShrink;
+        this->_reservedCapacity = other._reservedCapacity;
         this->maxNumOfElements = other.capacity();
         this->currNumOfElements = other.size();
-        delete [] this->_map;
-        this->_map = nullptr;
-        this->_map = new vector<pair<KeyT, ValueT>>[other.capacity()]();
-        for (size_t i = 0; i < other.capacity(); ++i)
+        this->_rehashStep = other._rehashStep;
+        this->_pool = other._pool;
+        this->_map = _newBuckets(other.capacity());
+        _copyElements(other, _pool);
+        return *this;
+    }
+
+    HashMap& operator =(HashMap&& other)
+    {
+        if (this != &other)
         {
-            vector<pair<KeyT, ValueT>> toCopy = other._map[i];
-            for (pair<KeyT, ValueT> pair: toCopy)
-            {
-                _map[i].push_back(pair);
-            }
+            HashMap toRelease(std::move(other));
+            _swap(toRelease);
         }
         return *this;
     }
@@ -599,6 +2380,13 @@ public:
     void clear()
     {
         this->currNumOfElements = 0;
+        if (_oldMap != nullptr)
+        {
+            size_t cap = capacity();
+            _deleteMaps();
+            _map = _newBuckets(cap);
+            return;
+        }
         for (size_t i = 0; i < capacity(); ++i)
         {
             _map[i].clear();
@@ -612,21 +2400,18 @@ public:
      */
     ValueT& operator [](const KeyT& key)
     {
-        if (!contains_key(key))
-        {
-            ValueT value;
-            insert(key, value);
-        }
-        int index = bucket_index(key);
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        auto it = bucket.begin();
-        int j = 0;
-        while (it->first != key && it != bucket.end())
-        {
-            it ++;
-            j++;
-        }
-        return std::get<1>(bucket[j]);
+        return _findOrInsert(key);
+    }
+
+    /**
+     * Returns a reference to the value that is mapped to a key equivalent to key. the key is moved into the
+     * container if it is inserted.
+     * @param key - the key of the element to find.
+     * @return - reference to the mapped value of the existing element whose key is equivalent to key.
+     */
+    ValueT& operator [](KeyT&& key)
+    {
+        return _findOrInsert(std::move(key));
     }
 
     /**
@@ -636,20 +2421,12 @@ public:
      */
     ValueT operator[](const KeyT& key) const
     {
-        if (!contains_key(key))
+        iterator it = find(key);
+        if (it == end())
         {
             return ValueT();
         }
-        int index = bucket_index(key);
-        vector<pair<KeyT, ValueT>>& bucket = _map[index];
-        auto it = bucket.begin();
-        int j = 0;
-        while (it->first != key && it != bucket.end())
-        {
-            it++;
-            j++;
-        }
-        return std::get<1>(bucket[j]);
+        return it->second;
     }
 
     /**
@@ -685,46 +2462,38 @@ public:
         return const_iterator(this, true);
     }
 
-    template<typename Key, typename Value>
+    template<typename Key, typename Value, typename H, typename E>
+    friend class ShardedHashMap;
+
+    template<typename Key, typename Value, typename H, typename E, bool S, typename A, size_t N>
     /**
      * Compares the contents of two unordered containers.
      * @param lhs - unordered container to compare.
      * @param rhs - unordered container to compare.
      * @return - true if the contents of the containers are equal, false otherwise.
      */
-    friend bool operator ==(const HashMap<Key, Value>& lhs, const HashMap<Key, Value>& rhs);
+    friend bool operator ==(const HashMap<Key, Value, H, E, S, A, N>& lhs, const HashMap<Key, Value, H, E, S, A, N>& rhs);
 
-    template<typename Key, typename Value>
+    template<typename Key, typename Value, typename H, typename E, bool S, typename A, size_t N>
     /**
      * Compares the contents of two unordered containers.
      * @param lhs - unordered container to compare.
      * @param rhs - unordered container to compare.
      * @return - false if the contents of the containers are equal, true otherwise.
      */
-    friend bool operator !=(const HashMap<Key, Value>& lhs, const HashMap<Key, Value>& rhs);
+    friend bool operator !=(const HashMap<Key, Value, H, E, S, A, N>& lhs, const HashMap<Key, Value, H, E, S, A, N>& rhs);
 
 
 };
 
-template<typename Key, typename Value>
-bool operator==(const HashMap<Key, Value> &lhs, const HashMap<Key, Value> &rhs)
+template<typename Key, typename Value, typename H, typename E, bool S, typename A, size_t N>
+bool operator==(const HashMap<Key, Value, H, E, S, A, N> &lhs, const HashMap<Key, Value, H, E, S, A, N> &rhs)
 {
-    if (lhs.size() != rhs.size() || lhs.capacity() != rhs.capacity())
-    {
-        return false;
-    }
-    for (size_t i = 0; i < lhs.capacity(); ++i)
-    {
-        if (!std::is_permutation(lhs._map[i].begin(), lhs._map[i].end(), rhs._map[i].begin(), rhs._map[i].end()))
-        {
-            return false;
-        }
-    }
-    return true;
+    return lhs.equals(rhs, lhs._pool);
 }
 
-template<typename Key, typename Value>
-bool operator!=(const HashMap<Key, Value> &lhs, const HashMap<Key, Value> &rhs)
+template<typename Key, typename Value, typename H, typename E, bool S, typename A, size_t N>
+bool operator!=(const HashMap<Key, Value, H, E, S, A, N> &lhs, const HashMap<Key, Value, H, E, S, A, N> &rhs)
 {
     return !(lhs == rhs);
 }
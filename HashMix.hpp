@@ -0,0 +1,60 @@
+#ifndef SUMMEREX6_HASHMIX_HPP
+#define SUMMEREX6_HASHMIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * murmur3 style finalizer that spreads every input bit over the whole hash code. std::hash of integers and pointers
+ * is the identity, so keys that share their low bits would otherwise land in the same few buckets.
+ * @param v - hash code to mix.
+ * @return - the mixed hash code.
+ */
+inline size_t mix_hash(size_t v)
+{
+    uint64_t h = v;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (size_t) h;
+}
+
+/**
+ * a hash policy that applies mix_hash to the result of another hash function, to be used as the Hash parameter of
+ * the maps.
+ * @tparam Hash - the hash function to mix.
+ */
+template<typename Hash>
+class MixedHash
+{
+private:
+    Hash _hash;
+
+public:
+    /**
+     * a constructor.
+     * @param hash - the hash function to mix.
+     */
+    explicit MixedHash(const Hash& hash = Hash()): _hash(hash)
+    {
+
+    }
+
+    /**
+     * hash a key.
+     * @tparam KeyT - type of the key.
+     * @param key - key to hash.
+     * @return - the mixed hash code.
+     */
+    template<typename KeyT>
+    size_t operator ()(const KeyT& key) const
+    {
+        return mix_hash(_hash(key));
+    }
+};
+
+
+#endif //SUMMEREX6_HASHMIX_HPP
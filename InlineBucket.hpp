@@ -0,0 +1,376 @@
+#ifndef SUMMEREX6_INLINEBUCKET_HPP
+#define SUMMEREX6_INLINEBUCKET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * a sequence with the interface of a vector that keeps its first N elements inside the object and only allocates
+ * when it grows beyond them. once it spills, all of its elements live in the allocated block. the allocator is
+ * propagated on move and swap.
+ * @tparam T - type of the elements.
+ * @tparam N - number of elements held inline, at least 1.
+ * @tparam Allocator - allocator of the spilled elements.
+ */
+template<typename T, size_t N, typename Allocator = std::allocator<T>>
+class InlineBucket
+{
+    static_assert(N > 0, "an inline bucket must hold at least one element inline.");
+
+private:
+    typedef std::allocator_traits<Allocator> Traits;
+
+    /**
+     * the storage of the bucket, derived from the allocator so an empty allocator takes no space. the elements live
+     * in local while capacity is N and in heap once it is larger.
+     */
+    struct Impl: public Allocator
+    {
+        union
+        {
+            T* heap;
+            typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type local;
+        };
+        uint32_t size;
+        uint32_t capacity;
+
+        explicit Impl(const Allocator& allocator): Allocator(allocator), size(0), capacity(N)
+        {
+
+        }
+    };
+
+    Impl _impl;
+
+    /**
+     * check whether the elements were moved to the heap.
+     * @return - true if the elements live in an allocated block.
+     */
+    bool _spilled() const
+    {
+        return _impl.capacity > N;
+    }
+
+    /**
+     * destroy all elements and free the allocated block, leaving an empty bucket with inline capacity.
+     */
+    void _release()
+    {
+        clear();
+        if (_spilled())
+        {
+            Traits::deallocate(_impl, _impl.heap, _impl.capacity);
+            _impl.capacity = N;
+        }
+    }
+
+    /**
+     * take the elements of another bucket, which is left empty. this bucket must be empty and not spilled.
+     * @param other - the bucket to take the elements of.
+     */
+    void _steal(InlineBucket& other)
+    {
+        if (other._spilled())
+        {
+            _impl.heap = other._impl.heap;
+            _impl.size = other._impl.size;
+            _impl.capacity = other._impl.capacity;
+            other._impl.size = 0;
+            other._impl.capacity = N;
+            return;
+        }
+        for (uint32_t i = 0; i < other._impl.size; ++i)
+        {
+            Traits::construct(_impl, data() + i, std::move(other.data()[i]));
+        }
+        _impl.size = other._impl.size;
+        other.clear();
+    }
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef Allocator allocator_type;
+
+    /**
+     * a constructor.
+     * @param allocator - allocator of the spilled elements.
+     */
+    explicit InlineBucket(const Allocator& allocator = Allocator()): _impl(allocator)
+    {
+
+    }
+
+    /**
+     * a copy constructor.
+     * @param other - bucket to copy.
+     */
+    InlineBucket(const InlineBucket& other): _impl(Traits::select_on_container_copy_construction(other._impl))
+    {
+        reserve(other.size());
+        for (const T& element : other)
+        {
+            push_back(element);
+        }
+    }
+
+    /**
+     * a move constructor, other is left empty.
+     * @param other - bucket to move.
+     */
+    InlineBucket(InlineBucket&& other): _impl(static_cast<const Allocator&>(other._impl))
+    {
+        _steal(other);
+    }
+
+    ~InlineBucket()
+    {
+        _release();
+    }
+
+    InlineBucket& operator =(const InlineBucket& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            reserve(other.size());
+            for (const T& element : other)
+            {
+                push_back(element);
+            }
+        }
+        return *this;
+    }
+
+    InlineBucket& operator =(InlineBucket&& other)
+    {
+        if (this != &other)
+        {
+            _release();
+            static_cast<Allocator&>(_impl) = static_cast<const Allocator&>(other._impl);
+            _steal(other);
+        }
+        return *this;
+    }
+
+    /**
+     * get the allocator of the bucket.
+     * @return - a copy of the allocator.
+     */
+    Allocator get_allocator() const
+    {
+        return _impl;
+    }
+
+    /**
+     * get a pointer to the first element.
+     * @return - pointer to the elements.
+     */
+    T* data()
+    {
+        return _spilled() ? _impl.heap : reinterpret_cast<T*>(&_impl.local);
+    }
+
+    const T* data() const
+    {
+        return _spilled() ? _impl.heap : reinterpret_cast<const T*>(&_impl.local);
+    }
+
+    size_t size() const
+    {
+        return _impl.size;
+    }
+
+    size_t capacity() const
+    {
+        return _impl.capacity;
+    }
+
+    bool empty() const
+    {
+        return _impl.size == 0;
+    }
+
+    iterator begin()
+    {
+        return data();
+    }
+
+    const_iterator begin() const
+    {
+        return data();
+    }
+
+    iterator end()
+    {
+        return data() + _impl.size;
+    }
+
+    const_iterator end() const
+    {
+        return data() + _impl.size;
+    }
+
+    T& operator [](size_t pos)
+    {
+        return data()[pos];
+    }
+
+    const T& operator [](size_t pos) const
+    {
+        return data()[pos];
+    }
+
+    T& back()
+    {
+        return data()[_impl.size - 1];
+    }
+
+    const T& back() const
+    {
+        return data()[_impl.size - 1];
+    }
+
+    /**
+     * make room for a number of elements, moving the elements to the heap if they do not fit inline.
+     * @param count - number of elements.
+     */
+    void reserve(size_t count)
+    {
+        if (count <= _impl.capacity)
+        {
+            return;
+        }
+        T* updated = Traits::allocate(_impl, count);
+        T* current = data();
+        for (uint32_t i = 0; i < _impl.size; ++i)
+        {
+            Traits::construct(_impl, updated + i, std::move_if_noexcept(current[i]));
+            Traits::destroy(_impl, current + i);
+        }
+        if (_spilled())
+        {
+            Traits::deallocate(_impl, _impl.heap, _impl.capacity);
+        }
+        _impl.heap = updated;
+        _impl.capacity = (uint32_t) count;
+    }
+
+    /**
+     * construct an element at the end of the bucket.
+     * @tparam Args - types of the arguments to construct the element from.
+     * @param args - arguments to construct the element from, they may refer to an element of the bucket.
+     * @return - reference to the new element.
+     */
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (_impl.size < _impl.capacity)
+        {
+            Traits::construct(_impl, data() + _impl.size, std::forward<Args>(args)...);
+            return data()[_impl.size++];
+        }
+        uint32_t updatedCap = _impl.capacity * 2;
+        T* updated = Traits::allocate(_impl, updatedCap);
+        Traits::construct(_impl, updated + _impl.size, std::forward<Args>(args)...);
+        T* current = data();
+        for (uint32_t i = 0; i < _impl.size; ++i)
+        {
+            Traits::construct(_impl, updated + i, std::move_if_noexcept(current[i]));
+            Traits::destroy(_impl, current + i);
+        }
+        if (_spilled())
+        {
+            Traits::deallocate(_impl, _impl.heap, _impl.capacity);
+        }
+        _impl.heap = updated;
+        _impl.capacity = updatedCap;
+        return updated[_impl.size++];
+    }
+
+    void push_back(const T& element)
+    {
+        emplace_back(element);
+    }
+
+    void push_back(T&& element)
+    {
+        emplace_back(std::move(element));
+    }
+
+    /**
+     * remove a range of elements, the following elements are moved back.
+     * @param first - first element to remove.
+     * @param last - element after the last to remove.
+     * @return - iterator to the element that followed the removed ones.
+     */
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        iterator target = begin() + (first - begin());
+        iterator source = begin() + (last - begin());
+        if (first == last)
+        {
+            return target;
+        }
+        iterator toReturn = std::move(source, end(), target);
+        for (iterator it = toReturn; it != end(); ++it)
+        {
+            Traits::destroy(_impl, it);
+        }
+        _impl.size = (uint32_t) (toReturn - begin());
+        return target;
+    }
+
+    /**
+     * remove an element, the following elements are moved back.
+     * @param pos - element to remove.
+     * @return - iterator to the element that followed the removed one.
+     */
+    iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+
+    /**
+     * destroy all elements, the capacity is kept.
+     */
+    void clear()
+    {
+        T* current = data();
+        for (uint32_t i = 0; i < _impl.size; ++i)
+        {
+            Traits::destroy(_impl, current + i);
+        }
+        _impl.size = 0;
+    }
+
+    /**
+     * exchange the contents of two buckets.
+     * @param other - bucket to exchange with.
+     */
+    void swap(InlineBucket& other)
+    {
+        if (_spilled() && other._spilled())
+        {
+            std::swap(static_cast<Allocator&>(_impl), static_cast<Allocator&>(other._impl));
+            std::swap(_impl.heap, other._impl.heap);
+            std::swap(_impl.size, other._impl.size);
+            std::swap(_impl.capacity, other._impl.capacity);
+            return;
+        }
+        InlineBucket toSwap(std::move(other));
+        other = std::move(*this);
+        *this = std::move(toSwap);
+    }
+};
+
+
+#endif //SUMMEREX6_INLINEBUCKET_HPP
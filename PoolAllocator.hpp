@@ -0,0 +1,250 @@
+#ifndef SUMMEREX6_POOLALLOCATOR_HPP
+#define SUMMEREX6_POOLALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/**
+ * a memory resource that carves small blocks out of large chunks. freed blocks are kept in one free list per size
+ * class and handed out again, and all chunks are released together when the resource is destroyed. blocks larger
+ * than the biggest size class go straight to operator new.
+ * not thread safe, every map that shares a resource must be used by one thread at a time.
+ */
+class PoolResource
+{
+private:
+    /**
+     * granularity and alignment of the size classes, the size of the largest class, and the size of the first
+     * chunk.
+     */
+    enum : size_t
+    {
+        kAlignment = alignof(std::max_align_t),
+        kMaxBlock = 1024,
+        kNumOfClasses = kMaxBlock / kAlignment,
+        kFirstChunk = 64 * 1024,
+        kMaxChunk = 4 * 1024 * 1024
+    };
+
+    /**
+     * a freed block, linked into the free list of its size class.
+     */
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    /**
+     * header of a chunk, chunks are linked so they can be released together.
+     */
+    struct Chunk
+    {
+        Chunk* next;
+    };
+
+    FreeBlock* _freeLists[kNumOfClasses] = {};
+    Chunk* _chunks = nullptr;
+    char* _current = nullptr;
+    char* _end = nullptr;
+    size_t _nextChunkSize = kFirstChunk;
+
+    /**
+     * get the size class of a block size.
+     * @param bytes - requested size, at most kMaxBlock.
+     * @return - index of the free list.
+     */
+    static size_t _classOf(size_t bytes)
+    {
+        return bytes == 0 ? 0 : (bytes - 1) / kAlignment;
+    }
+
+    /**
+     * allocate a new chunk and make it the current one.
+     * @param minBytes - number of bytes the chunk must be able to hand out.
+     */
+    void _newChunk(size_t minBytes)
+    {
+        size_t header = (sizeof(Chunk) + kAlignment - 1) / kAlignment * kAlignment;
+        size_t chunkSize = _nextChunkSize;
+        while (chunkSize < minBytes + header)
+        {
+            chunkSize *= 2;
+        }
+        if (_nextChunkSize < kMaxChunk)
+        {
+            _nextChunkSize *= 2;
+        }
+        Chunk* chunk = static_cast<Chunk*>(::operator new(chunkSize));
+        chunk->next = _chunks;
+        _chunks = chunk;
+        _current = reinterpret_cast<char*>(chunk) + header;
+        _end = reinterpret_cast<char*>(chunk) + chunkSize;
+    }
+
+public:
+    PoolResource() = default;
+
+    PoolResource(const PoolResource&) = delete;
+
+    PoolResource& operator =(const PoolResource&) = delete;
+
+    /**
+     * releases all chunks at once.
+     */
+    ~PoolResource()
+    {
+        while (_chunks != nullptr)
+        {
+            Chunk* next = _chunks->next;
+            ::operator delete(_chunks);
+            _chunks = next;
+        }
+    }
+
+    /**
+     * allocate a block.
+     * @param bytes - size of the block.
+     * @return - pointer to a block aligned to alignof(std::max_align_t).
+     */
+    void* allocate(size_t bytes)
+    {
+        if (bytes > kMaxBlock)
+        {
+            return ::operator new(bytes);
+        }
+        size_t sizeClass = _classOf(bytes);
+        FreeBlock* block = _freeLists[sizeClass];
+        if (block != nullptr)
+        {
+            _freeLists[sizeClass] = block->next;
+            return block;
+        }
+        size_t blockSize = (sizeClass + 1) * kAlignment;
+        if ((size_t) (_end - _current) < blockSize)
+        {
+            _newChunk(blockSize);
+        }
+        void* result = _current;
+        _current += blockSize;
+        return result;
+    }
+
+    /**
+     * return a block to the resource.
+     * @param p - pointer returned by allocate.
+     * @param bytes - size that was passed to allocate.
+     */
+    void deallocate(void* p, size_t bytes)
+    {
+        if (bytes > kMaxBlock)
+        {
+            ::operator delete(p);
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        size_t sizeClass = _classOf(bytes);
+        block->next = _freeLists[sizeClass];
+        _freeLists[sizeClass] = block;
+    }
+};
+
+/**
+ * an allocator that takes its memory from a shared PoolResource. a default constructed allocator creates its own
+ * resource, copies and rebinds share it, and the resource is released once the last allocator that uses it is gone,
+ * so a map that uses a PoolAllocator frees all of its memory at once.
+ * @tparam T - type of the allocated objects.
+ */
+template<typename T>
+class PoolAllocator
+{
+private:
+    template<typename U>
+    friend class PoolAllocator;
+
+    std::shared_ptr<PoolResource> _resource;
+
+public:
+    typedef T value_type;
+
+    /**
+     * a default constructor, creates a new resource.
+     */
+    PoolAllocator(): _resource(std::make_shared<PoolResource>())
+    {
+
+    }
+
+    /**
+     * a constructor to allocate from an existing resource.
+     * @param resource - the resource.
+     */
+    explicit PoolAllocator(const std::shared_ptr<PoolResource>& resource): _resource(resource)
+    {
+
+    }
+
+    /**
+     * a converting constructor, shares the resource of other.
+     * @param other - allocator of another type.
+     */
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& other): _resource(other._resource)
+    {
+
+    }
+
+    /**
+     * a copy of a container gets a resource of its own, so the copy can be used by another thread.
+     * @return - an allocator with a new resource.
+     */
+    PoolAllocator select_on_container_copy_construction() const
+    {
+        return PoolAllocator();
+    }
+
+    /**
+     * allocate memory for objects.
+     * @param n - number of objects.
+     * @return - pointer to uninitialized memory.
+     */
+    T* allocate(size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned types are not supported.");
+        return static_cast<T*>(_resource->allocate(n * sizeof(T)));
+    }
+
+    /**
+     * free memory returned by allocate.
+     * @param p - pointer to the memory.
+     * @param n - number of objects that was passed to allocate.
+     */
+    void deallocate(T* p, size_t n)
+    {
+        _resource->deallocate(p, n * sizeof(T));
+    }
+
+    /**
+     * get the resource of the allocator.
+     * @return - the resource.
+     */
+    const std::shared_ptr<PoolResource>& resource() const
+    {
+        return _resource;
+    }
+
+    template<typename U>
+    bool operator ==(const PoolAllocator<U>& other) const
+    {
+        return _resource == other._resource;
+    }
+
+    template<typename U>
+    bool operator !=(const PoolAllocator<U>& other) const
+    {
+        return _resource != other._resource;
+    }
+};
+
+
+#endif //SUMMEREX6_POOLALLOCATOR_HPP
@@ -0,0 +1,21 @@
+#ifndef SUMMEREX6_PREFETCH_HPP
+#define SUMMEREX6_PREFETCH_HPP
+
+/**
+ * ask the processor to start loading the cache line that holds an address, so a later read of it does not stall.
+ * the batched lookups of the maps prefetch the buckets of a whole group of keys before they compare any key, so the
+ * cache misses of the group overlap instead of following each other. a prefetch never faults, so the address may
+ * be null or point past an allocation.
+ * @param address - the address to load.
+ */
+inline void prefetch_read(const void* address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void) address;
+#endif
+}
+
+
+#endif //SUMMEREX6_PREFETCH_HPP
@@ -0,0 +1,398 @@
+#ifndef SUMMEREX6_READMOSTLYHASHMAP_HPP
+#define SUMMEREX6_READMOSTLYHASHMAP_HPP
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "EpochReclaimer.hpp"
+
+using std::pair;
+using std::vector;
+
+/**
+ * a thread safe associative container for maps that are read far more often than they are updated.
+ * lookups take no lock: they enter an epoch and read the bucket array and the buckets through atomic pointers.
+ * updates are serialized by a mutex and never modify what a reader may see. an update copies the bucket it changes
+ * and publishes the copy, and a resize builds a new bucket array and publishes it, while the replaced buckets and
+ * arrays are retired to an EpochReclaimer and freed once no reader can see them.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class ReadMostlyHashMap
+{
+private:
+    /**
+     * an element along with the hash code of its key.
+     */
+    struct Entry
+    {
+        size_t hash;
+        pair<KeyT, ValueT> element;
+    };
+
+    /**
+     * the elements of a bucket, never modified once published. an empty bucket is represented by nullptr.
+     */
+    typedef vector<Entry> Bucket;
+
+    /**
+     * an array of buckets, its size is a power of two.
+     */
+    struct Table
+    {
+        size_t capacity;
+        std::atomic<Bucket*>* buckets;
+
+        explicit Table(size_t cap): capacity(cap), buckets(new std::atomic<Bucket*>[cap])
+        {
+            for (size_t i = 0; i < cap; ++i)
+            {
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        Table(const Table&) = delete;
+
+        Table& operator =(const Table&) = delete;
+
+        /**
+         * frees the buckets that are still published in the table.
+         */
+        ~Table()
+        {
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                delete buckets[i].load(std::memory_order_relaxed);
+            }
+            delete [] buckets;
+        }
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * threshold to determine when to increase the table.
+     */
+    double upperThreshold;
+
+    /**
+     * the published table.
+     */
+    std::atomic<Table*> _table;
+
+    /**
+     * number of elements, written only by updates.
+     */
+    std::atomic<size_t> _size;
+
+    /**
+     * serializes the updates.
+     */
+    std::mutex _writeLock;
+
+    /**
+     * frees the retired buckets and tables.
+     */
+    mutable EpochReclaimer _reclaimer;
+
+    /**
+     * get the position of a key in a bucket.
+     * @param bucket - the bucket to search, may be nullptr.
+     * @param hash - hash code of the key.
+     * @param key - the key to look for.
+     * @return - index of the element with the given key, or -1 if there is none.
+     */
+    long _position(const Bucket* bucket, size_t hash, const KeyT& key) const
+    {
+        if (bucket == nullptr)
+        {
+            return -1;
+        }
+        for (size_t i = 0; i < bucket->size(); ++i)
+        {
+            if ((*bucket)[i].hash == hash && _keyEqual((*bucket)[i].element.first, key))
+            {
+                return (long) i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * call a function on the element with a given key, inside an epoch.
+     * @tparam Function - type of the function, callable with const pair<KeyT, ValueT>*.
+     * @param key - the key to look for.
+     * @param function - called with the element, or with nullptr if there is none.
+     * @return - the result of the function.
+     */
+    template<typename Function>
+    auto _read(const KeyT& key, Function function) const -> decltype(function(nullptr))
+    {
+        size_t hash = _hasher(key);
+        EpochReclaimer::Guard guard(_reclaimer);
+        const Table* table = _table.load(std::memory_order_acquire);
+        const Bucket* bucket = table->buckets[hash & (table->capacity - 1)].load(std::memory_order_acquire);
+        long pos = _position(bucket, hash, key);
+        return function(pos < 0 ? nullptr : &(*bucket)[pos].element);
+    }
+
+    /**
+     * publish a bucket in place of another one and retire the replaced bucket. _writeLock must be held.
+     * @param table - the published table.
+     * @param index - index of the bucket.
+     * @param updated - the new bucket, nullptr for an empty one.
+     */
+    void _publish(Table* table, size_t index, Bucket* updated)
+    {
+        Bucket* replaced = table->buckets[index].exchange(updated, std::memory_order_acq_rel);
+        _reclaimer.retire(replaced);
+    }
+
+    /**
+     * publish a table of double the capacity holding all elements, and retire the current one along with its
+     * buckets. _writeLock must be held.
+     */
+    void _increaseMapSize()
+    {
+        Table* current = _table.load(std::memory_order_relaxed);
+        Table* updated = new Table(current->capacity * 2);
+        for (size_t i = 0; i < current->capacity; ++i)
+        {
+            const Bucket* bucket = current->buckets[i].load(std::memory_order_relaxed);
+            if (bucket == nullptr)
+            {
+                continue;
+            }
+            for (const Entry& entry : *bucket)
+            {
+                std::atomic<Bucket*>& target = updated->buckets[entry.hash & (updated->capacity - 1)];
+                Bucket* targetBucket = target.load(std::memory_order_relaxed);
+                if (targetBucket == nullptr)
+                {
+                    targetBucket = new Bucket();
+                    target.store(targetBucket, std::memory_order_relaxed);
+                }
+                targetBucket->push_back(entry);
+            }
+        }
+        _table.store(updated, std::memory_order_release);
+        _reclaimer.retire(current);
+    }
+
+    /**
+     * add or replace the element of a key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @param assign - whether an existing value is replaced.
+     * @return - true if the key was inserted.
+     */
+    bool _update(const KeyT& key, const ValueT& value, bool assign)
+    {
+        size_t hash = _hasher(key);
+        std::lock_guard<std::mutex> lock(_writeLock);
+        Table* table = _table.load(std::memory_order_relaxed);
+        size_t index = hash & (table->capacity - 1);
+        const Bucket* bucket = table->buckets[index].load(std::memory_order_relaxed);
+        long pos = _position(bucket, hash, key);
+        if (pos >= 0)
+        {
+            if (assign)
+            {
+                Bucket* updated = new Bucket(*bucket);
+                (*updated)[pos].element.second = value;
+                _publish(table, index, updated);
+            }
+            return false;
+        }
+        if ((double) (_size.load(std::memory_order_relaxed) + 1) / (double) table->capacity > upperThreshold)
+        {
+            _increaseMapSize();
+            table = _table.load(std::memory_order_relaxed);
+            index = hash & (table->capacity - 1);
+            bucket = table->buckets[index].load(std::memory_order_relaxed);
+        }
+        Bucket* updated = bucket == nullptr ? new Bucket() : new Bucket(*bucket);
+        updated->push_back(Entry{hash, pair<KeyT, ValueT>(key, value)});
+        _publish(table, index, updated);
+        _size.store(_size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+public:
+    /**
+     * a constructor.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit ReadMostlyHashMap(const Hash& hash = Hash(), const KeyEqual& keyEqual = KeyEqual()): _hasher(hash),
+            _keyEqual(keyEqual), upperThreshold(0.75), _table(new Table(16)), _size(0)
+    {
+
+    }
+
+    ReadMostlyHashMap(const ReadMostlyHashMap&) = delete;
+
+    ReadMostlyHashMap& operator =(const ReadMostlyHashMap&) = delete;
+
+    /**
+     * frees the table, no thread may use the map anymore.
+     */
+    ~ReadMostlyHashMap()
+    {
+        delete _table.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * get the number of elements the map currently contains.
+     * @return - the number of elements.
+     */
+    size_t size() const
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * get the capacity of the map.
+     * @return - the capacity.
+     */
+    size_t capacity() const
+    {
+        EpochReclaimer::Guard guard(_reclaimer);
+        return _table.load(std::memory_order_acquire)->capacity;
+    }
+
+    /**
+     * check if the map is empty.
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * checks if the container contains element with specific key, without taking a lock.
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key) const
+    {
+        return _read(key, [](const pair<KeyT, ValueT>* element) { return element != nullptr; });
+    }
+
+    /**
+     * Returns a copy of the value mapped to key, without taking a lock. If no such element exists, an exception of
+     * type std::out_of_range is thrown.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the requested element.
+     */
+    ValueT at(const KeyT& key) const
+    {
+        return _read(key, [](const pair<KeyT, ValueT>* element)
+        {
+            if (element == nullptr)
+            {
+                throw std::out_of_range("Hash map does not contain the given key.");
+            }
+            return element->second;
+        });
+    }
+
+    /**
+     * copy the value mapped to key if there is one, without taking a lock.
+     * @param key - the key of the element to find.
+     * @param value - set to the mapped value if the key was found.
+     * @return - true if the key was found, false otherwise.
+     */
+    bool find(const KeyT& key, ValueT& value) const
+    {
+        return _read(key, [&value](const pair<KeyT, ValueT>* element)
+        {
+            if (element == nullptr)
+            {
+                return false;
+            }
+            value = element->second;
+            return true;
+        });
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        return _update(key, value, false);
+    }
+
+    /**
+     * Assigns value to the element with the given key, or inserts a new element if there is no such key.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the insertion took place, false if the assignment took place.
+     */
+    bool insert_or_assign(const KeyT& key, const ValueT& value)
+    {
+        return _update(key, value, true);
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key. the table is never decreased.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        size_t hash = _hasher(key);
+        std::lock_guard<std::mutex> lock(_writeLock);
+        Table* table = _table.load(std::memory_order_relaxed);
+        size_t index = hash & (table->capacity - 1);
+        const Bucket* bucket = table->buckets[index].load(std::memory_order_relaxed);
+        long pos = _position(bucket, hash, key);
+        if (pos < 0)
+        {
+            return false;
+        }
+        Bucket* updated = nullptr;
+        if (bucket->size() > 1)
+        {
+            updated = new Bucket(*bucket);
+            updated->erase(updated->begin() + pos);
+        }
+        _publish(table, index, updated);
+        _size.store(_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Erases all elements from the container by publishing an empty table.
+     */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_writeLock);
+        Table* current = _table.load(std::memory_order_relaxed);
+        _table.store(new Table(16), std::memory_order_release);
+        _size.store(0, std::memory_order_relaxed);
+        _reclaimer.retire(current);
+    }
+};
+
+
+#endif //SUMMEREX6_READMOSTLYHASHMAP_HPP
@@ -0,0 +1,785 @@
+#ifndef SUMMEREX6_ROBINHOODHASHMAP_HPP
+#define SUMMEREX6_ROBINHOODHASHMAP_HPP
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include "HashMix.hpp"
+#include "Prefetch.hpp"
+using std::pair;
+
+/**
+ * an open-addressing associative container that uses robin hood hashing: on insertion an element takes the slot of
+ * any element that is closer to its home slot, which keeps the variance of probe lengths low even at high load
+ * factors. erasing shifts the following elements one slot back instead of leaving tombstones.
+ * it is a container of its own, not a backend of HashMap, and offers only the core of the interface of HashMap: size,
+ * capacity, empty, insert, contains_key, at, operator[], erase, contains_many, at_many, load_factor, clear,
+ * iteration, copying and comparison. code that uses only these can switch between the two by type.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys. its results are always passed through mix_hash, since the home slot
+ * is taken from their low bits.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class RobinHoodHashMap
+{
+private:
+    typedef uint32_t dist_t;
+
+    /**
+     * the smallest capacity of the table.
+     */
+    enum : size_t
+    {
+        kMinCapacity = 16,
+        kLookupGroup = 16
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * maximum ratio between the number of elements and the capacity before the table grows.
+     */
+    double maxLoadFactor{};
+
+    /**
+     * probe distance of each slot plus one, 0 marks an empty slot.
+     */
+    dist_t* _dist = nullptr;
+
+    /**
+     * the slot array. a slot is constructed only while its distance is not 0.
+     */
+    pair<KeyT, ValueT>* _slots = nullptr;
+
+    /**
+     * number of slots in the table, always a power of two.
+     */
+    size_t _capacity{};
+
+    /**
+     * number of elements the map currently holds.
+     */
+    size_t _size{};
+
+    /**
+     * get the slot a key belongs in.
+     * @param key - key to hash.
+     * @return - index of the home slot of key.
+     */
+    size_t _home(const KeyT& key) const
+    {
+        return mix_hash(_hasher(key)) & (_capacity - 1);
+    }
+
+    /**
+     * allocate an empty table.
+     * @param capacity - number of slots, a power of two of at least kMinCapacity.
+     */
+    void _allocate(size_t capacity)
+    {
+        _dist = new dist_t[capacity]();
+        _slots = std::allocator<pair<KeyT, ValueT>>().allocate(capacity);
+        _capacity = capacity;
+    }
+
+    /**
+     * destroy all elements and free the table.
+     */
+    void _free()
+    {
+        if (_dist == nullptr)
+        {
+            return;
+        }
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_dist[i] != 0)
+            {
+                _slots[i].~pair();
+            }
+        }
+        std::allocator<pair<KeyT, ValueT>>().deallocate(_slots, _capacity);
+        delete [] _dist;
+        _dist = nullptr;
+        _slots = nullptr;
+    }
+
+    /**
+     * find the slot of a key. the probe stops as soon as it reaches an element that is closer to its home than key
+     * would be, since key would have displaced it.
+     * @param key - key to look for.
+     * @return - index of the slot holding key, or capacity() if there is no such slot.
+     */
+    size_t _find(const KeyT& key) const
+    {
+        return _findFrom(key, _home(key));
+    }
+
+    /**
+     * find the slot of a key, starting the probe from its home slot.
+     * @param key - key to look for.
+     * @param pos - the home slot of key.
+     * @return - index of the slot holding key, or capacity() if there is no such slot.
+     */
+    size_t _findFrom(const KeyT& key, size_t pos) const
+    {
+        const size_t mask = _capacity - 1;
+        for (size_t dist = 1; _dist[pos] >= dist; ++dist)
+        {
+            if (_keyEqual(_slots[pos].first, key))
+            {
+                return pos;
+            }
+            pos = (pos + 1) & mask;
+        }
+        return _capacity;
+    }
+
+    /**
+     * look up a sequence of keys in groups. the home slot of every key of a group is prefetched, along with its
+     * probe distance, and only then are the keys looked up.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam Visitor - type of the visitor, callable with the index of the slot of a key, or capacity() if the key
+     * is not in the map.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param visit - called once for every key, in order.
+     */
+    template<typename ForwardIterator, typename Visitor>
+    void _lookupMany(ForwardIterator keysBegin, ForwardIterator keysEnd, Visitor& visit) const
+    {
+        const KeyT* keys[kLookupGroup];
+        size_t homes[kLookupGroup];
+        while (keysBegin != keysEnd)
+        {
+            size_t count = 0;
+            for (; keysBegin != keysEnd && count < kLookupGroup; ++keysBegin, ++count)
+            {
+                keys[count] = std::addressof(*keysBegin);
+                homes[count] = _home(*keys[count]);
+                prefetch_read(_dist + homes[count]);
+                prefetch_read(_slots + homes[count]);
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                visit(_findFrom(*keys[i], homes[i]));
+            }
+        }
+    }
+
+    /**
+     * place an element whose key is not in the table yet, displacing every element that is closer to its home.
+     * @param element - the element to place, its content is unspecified afterwards.
+     * @return - index of the slot the element ended up in.
+     */
+    size_t _place(pair<KeyT, ValueT>&& element)
+    {
+        const size_t mask = _capacity - 1;
+        size_t pos = _home(element.first);
+        size_t placedAt = _capacity;
+        dist_t dist = 1;
+        while (_dist[pos] != 0)
+        {
+            if (_dist[pos] < dist)
+            {
+                std::swap(element, _slots[pos]);
+                std::swap(dist, _dist[pos]);
+                if (placedAt == _capacity)
+                {
+                    placedAt = pos;
+                }
+            }
+            pos = (pos + 1) & mask;
+            dist++;
+        }
+        new (_slots + pos) pair<KeyT, ValueT>(std::move(element));
+        _dist[pos] = dist;
+        return placedAt == _capacity ? pos : placedAt;
+    }
+
+    /**
+     * rebuild the table with a new capacity.
+     * @param capacity - the new capacity.
+     */
+    void _resize(size_t capacity)
+    {
+        dist_t* oldDist = _dist;
+        pair<KeyT, ValueT>* oldSlots = _slots;
+        size_t oldCapacity = _capacity;
+        _allocate(capacity);
+        for (size_t i = 0; i < oldCapacity; ++i)
+        {
+            if (oldDist[i] != 0)
+            {
+                _place(std::move(oldSlots[i]));
+                oldSlots[i].~pair();
+            }
+        }
+        std::allocator<pair<KeyT, ValueT>>().deallocate(oldSlots, oldCapacity);
+        delete [] oldDist;
+    }
+
+    /**
+     * insert an element whose key is not in the table yet, growing the table first if needed.
+     * @param element - the element to insert.
+     * @return - index of the slot holding the element.
+     */
+    size_t _insertNew(pair<KeyT, ValueT>&& element)
+    {
+        if ((double) (_size + 1) > maxLoadFactor * (double) _capacity)
+        {
+            _resize(_capacity * 2);
+        }
+        size_t index = _place(std::move(element));
+        _size++;
+        return index;
+    }
+
+    /**
+     * destroy the element in a full slot, and shift the run of displaced elements after it one slot back.
+     * @param index - index of the slot.
+     */
+    void _eraseAt(size_t index)
+    {
+        const size_t mask = _capacity - 1;
+        _slots[index].~pair();
+        size_t next = (index + 1) & mask;
+        while (_dist[next] > 1)
+        {
+            new (_slots + index) pair<KeyT, ValueT>(std::move(_slots[next]));
+            _slots[next].~pair();
+            _dist[index] = _dist[next] - 1;
+            index = next;
+            next = (next + 1) & mask;
+        }
+        _dist[index] = 0;
+        _size--;
+    }
+
+public:
+
+    /**
+     * an iterator for the map.
+     */
+    class const_iterator: public std::iterator<std::forward_iterator_tag, pair<KeyT, ValueT>>
+    {
+    private:
+        const RobinHoodHashMap* _map;
+        size_t _index;
+
+        /**
+         * move forward to the first full slot at or after the current one.
+         */
+        void _skipEmpty()
+        {
+            while (_index < _map->_capacity && _map->_dist[_index] == 0)
+            {
+                _index++;
+            }
+        }
+
+    public:
+        typedef const_iterator self_type;
+        typedef pair<KeyT, ValueT> value_type;
+        typedef const pair<KeyT, ValueT>& reference;
+        typedef const pair<KeyT, ValueT>* pointer;
+        typedef std::forward_iterator_tag iterator_category;
+        typedef int difference_type;
+
+        /**
+         * default constructor.
+         */
+        const_iterator(): _map(nullptr), _index(0)
+        {
+
+        }
+
+        /**
+         * a constructor to construct from a map and a slot.
+         * @param map - map to iterate.
+         * @param index - first slot to consider, the iterator moves to the first full slot from it on.
+         */
+        const_iterator(const RobinHoodHashMap* map, size_t index): _map(map), _index(index)
+        {
+            _skipEmpty();
+        }
+
+        /**
+         * dereference operator.
+         * @return - pair<KeyT, ValueT>.
+         */
+        reference operator *() const
+        {
+            return _map->_slots[_index];
+        }
+
+        /**
+         * pointer operator.
+         * @return - pointer to the current pair.
+         */
+        pointer operator ->() const
+        {
+            return _map->_slots + _index;
+        }
+
+        /**
+         * forwarding operator.
+         * @return - self after moving.
+         */
+        self_type& operator ++()
+        {
+            _index++;
+            _skipEmpty();
+            return *this;
+        }
+
+        /**
+         * forwarding operator.
+         * @return - a copy of self before moving.
+         */
+        self_type operator ++(int)
+        {
+            self_type toReturn = *this;
+            ++(*this);
+            return toReturn;
+        }
+
+        /**
+         * compare to other iterator.
+         * @param other - other iterator for comparison.
+         * @return - true if equal, false else.
+         */
+        bool operator ==(const self_type& other) const
+        {
+            return _index == other._index && _map == other._map;
+        }
+
+        /**
+         * compare to other iterator.
+         * @param other - other iterator for comparison.
+         * @return - true if different, false else.
+         */
+        bool operator !=(const self_type& other) const
+        {
+            return !(this->operator==(other));
+        }
+    };
+
+    typedef const_iterator iterator;
+
+    /**
+     * a constructor.
+     * @param maxLoad - ratio between size and capacity above which the table grows, in (0, 1).
+     */
+    explicit RobinHoodHashMap(double maxLoad = 0.9): RobinHoodHashMap(maxLoad, Hash())
+    {
+
+    }
+
+    /**
+     * a constructor with given hash and key equality functions.
+     * @param maxLoad - ratio between size and capacity above which the table grows, in (0, 1).
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    RobinHoodHashMap(double maxLoad, const Hash& hash, const KeyEqual& keyEqual = KeyEqual()): _hasher(hash),
+            _keyEqual(keyEqual), maxLoadFactor(maxLoad)
+    {
+        if (!(maxLoad > 0 && maxLoad < 1))
+        {
+            throw std::invalid_argument("max load factor must be between 0 and 1.");
+        }
+        _allocate(kMinCapacity);
+    }
+
+    /**
+     * a copy constructor.
+     * @param other - other map to copy from.
+     */
+    RobinHoodHashMap(const RobinHoodHashMap& other): _hasher(other._hasher), _keyEqual(other._keyEqual),
+                                                     maxLoadFactor(other.maxLoadFactor), _size(other._size)
+    {
+        _allocate(other._capacity);
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (other._dist[i] != 0)
+            {
+                new (_slots + i) pair<KeyT, ValueT>(other._slots[i]);
+                _dist[i] = other._dist[i];
+            }
+        }
+    }
+
+    /**
+     * gets 2 iterators for keys and values and stores them in the map.
+     * @tparam KeysInputIterator - iterator to keys.
+     * @tparam ValuesInputIterator - iterator to values.
+     * @param keysBegin - beginning of keys vector.
+     * @param keysEnd - end of keys vector.
+     * @param valuesBegin - beginning of values vector.
+     * @param valuesEnd - end of values vector.
+     */
+    template<typename KeysInputIterator, typename ValuesInputIterator>
+    RobinHoodHashMap(KeysInputIterator keysBegin, KeysInputIterator keysEnd, ValuesInputIterator valuesBegin,
+                     ValuesInputIterator valuesEnd): RobinHoodHashMap()
+    {
+        if (std::distance(keysBegin, keysEnd) != std::distance(valuesBegin, valuesEnd))
+        {
+            throw std::length_error("given vectors are of different size.");
+        }
+        for (; keysBegin != keysEnd; ++keysBegin, ++valuesBegin)
+        {
+            this->operator[](*keysBegin) = *valuesBegin;
+        }
+    }
+
+    /**
+     * deletes and frees the map.
+     */
+    ~RobinHoodHashMap()
+    {
+        _free();
+    }
+
+    /**
+     * get the number of elements the map currently contains.
+     * @return - the number of elements the map currently contains.
+     */
+    size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * get the capacity of the map.
+     * @return - the capacity.
+     */
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * check if the map is empty.
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        if (_find(key) != _capacity)
+        {
+            return false;
+        }
+        _insertNew(pair<KeyT, ValueT>(key, value));
+        return true;
+    }
+
+    /**
+     * checks if the container contains element with specific key
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key) const
+    {
+        return _find(key) != _capacity;
+    }
+
+    /**
+     * Returns a reference to the mapped value of the element with key equivalent to key. If no such element exists,
+     * an exception of type std::out_of_range is thrown.
+     * @param key - the key of the element to find.
+     * @return - Reference to the mapped value of the requested element.
+     */
+    ValueT& at(const KeyT& key)
+    {
+        size_t index = _find(key);
+        if (index == _capacity)
+        {
+            throw std::out_of_range("Hash map does not contain given key.");
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * Returns a const reference to the mapped value of the element with key equivalent to key. If no such element
+     * exists, an exception of type std::out_of_range is thrown.
+     * @param key - the key of the element to find.
+     * @return - Reference to the mapped value of the requested element.
+     */
+    const ValueT& at(const KeyT& key) const
+    {
+        size_t index = _find(key);
+        if (index == _capacity)
+        {
+            throw std::out_of_range("Hash map does not contain the given key.");
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * checks for every key of a batch if the container contains an element with that key. the home slots of a group
+     * of keys are prefetched before any key is compared, which hides most of the memory latency when the table is
+     * larger than the cache.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives bools.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives true or false for every key, in the order of the keys.
+     * @return - the output iterator past the last value written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator contains_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index)
+        {
+            *out++ = index != _capacity;
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
+    }
+
+    /**
+     * copies the mapped values of a batch of keys, prefetching as contains_many does. If one of the keys is not in
+     * the map, an exception of type std::out_of_range is thrown, after the values of the keys before it were written.
+     * @tparam ForwardIterator - type of the iterators to the keys.
+     * @tparam OutputIterator - type of the output iterator, it receives values.
+     * @param keysBegin - beginning of the keys.
+     * @param keysEnd - end of the keys.
+     * @param out - receives the mapped value of every key, in the order of the keys.
+     * @return - the output iterator past the last value written.
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator at_many(ForwardIterator keysBegin, ForwardIterator keysEnd, OutputIterator out) const
+    {
+        auto visit = [this, &out](size_t index)
+        {
+            if (index == _capacity)
+            {
+                throw std::out_of_range("Hash map does not contain the given key.");
+            }
+            *out++ = _slots[index].second;
+        };
+        _lookupMany(keysBegin, keysEnd, visit);
+        return out;
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key. the table is never shrunk, and no
+     * tombstone is left behind.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        size_t index = _find(key);
+        if (index == _capacity)
+        {
+            return false;
+        }
+        _eraseAt(index);
+        return true;
+    }
+
+    /**
+     * Returns the ratio between the number of elements and the number of slots.
+     * @return - the load factor.
+     */
+    double load_factor() const
+    {
+        return (double) size() / (double) capacity();
+    }
+
+    /**
+     * get the longest probe sequence, that is the largest distance of an element from its home slot.
+     * @return - the maximum probe distance, 0 for an empty map.
+     */
+    size_t max_probe_distance() const
+    {
+        size_t maxDist = 0;
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_dist[i] != 0 && _dist[i] - 1 > maxDist)
+            {
+                maxDist = _dist[i] - 1;
+            }
+        }
+        return maxDist;
+    }
+
+    /**
+     * get the average distance of the elements from their home slots.
+     * @return - the mean probe distance, 0 for an empty map.
+     */
+    double mean_probe_distance() const
+    {
+        if (empty())
+        {
+            return 0;
+        }
+        double total = 0;
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_dist[i] != 0)
+            {
+                total += _dist[i] - 1;
+            }
+        }
+        return total / (double) size();
+    }
+
+    RobinHoodHashMap& operator =(const RobinHoodHashMap& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        RobinHoodHashMap copy(other);
+        std::swap(_hasher, copy._hasher);
+        std::swap(_keyEqual, copy._keyEqual);
+        std::swap(maxLoadFactor, copy.maxLoadFactor);
+        std::swap(_dist, copy._dist);
+        std::swap(_slots, copy._slots);
+        std::swap(_capacity, copy._capacity);
+        std::swap(_size, copy._size);
+        return *this;
+    }
+
+    /**
+     * Erases all elements from the container. After this call, size() returns zero.
+     */
+    void clear()
+    {
+        for (size_t i = 0; i < _capacity; ++i)
+        {
+            if (_dist[i] != 0)
+            {
+                _slots[i].~pair();
+                _dist[i] = 0;
+            }
+        }
+        _size = 0;
+    }
+
+    /**
+     * Returns a reference to the value that is mapped to a key equivalent to key, inserting a default value if no
+     * such key exists.
+     * @param key - the key of the element to find.
+     * @return - reference to the mapped value of the element whose key is equivalent to key.
+     */
+    ValueT& operator [](const KeyT& key)
+    {
+        size_t index = _find(key);
+        if (index == _capacity)
+        {
+            index = _insertNew(pair<KeyT, ValueT>(key, ValueT()));
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * Returns the value that is mapped to a key equivalent to key.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the existing element whose key is equivalent to key, or a default value.
+     */
+    ValueT operator [](const KeyT& key) const
+    {
+        size_t index = _find(key);
+        if (index == _capacity)
+        {
+            return ValueT();
+        }
+        return _slots[index].second;
+    }
+
+    /**
+     * return a const iterator to the beginning of the map.
+     */
+    iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    /**
+     * @return - a const iterator to beginning of the map.
+     */
+    const_iterator cbegin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    /**
+     * return a const iterator to the end of the map.
+     */
+    iterator end() const
+    {
+        return const_iterator(this, _capacity);
+    }
+
+    /**
+     * return a const iterator to the end of the map.
+     */
+    const_iterator cend() const
+    {
+        return const_iterator(this, _capacity);
+    }
+
+    /**
+     * Compares the contents of two maps.
+     * @param lhs - map to compare.
+     * @param rhs - map to compare.
+     * @return - true if the contents of the maps are equal, false otherwise.
+     */
+    friend bool operator ==(const RobinHoodHashMap& lhs, const RobinHoodHashMap& rhs)
+    {
+        if (lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        for (const pair<KeyT, ValueT>& element : lhs)
+        {
+            size_t index = rhs._find(element.first);
+            if (index == rhs._capacity || !(rhs._slots[index].second == element.second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Compares the contents of two maps.
+     * @param lhs - map to compare.
+     * @param rhs - map to compare.
+     * @return - false if the contents of the maps are equal, true otherwise.
+     */
+    friend bool operator !=(const RobinHoodHashMap& lhs, const RobinHoodHashMap& rhs)
+    {
+        return !(lhs == rhs);
+    }
+};
+
+
+#endif //SUMMEREX6_ROBINHOODHASHMAP_HPP
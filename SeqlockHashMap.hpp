@@ -0,0 +1,601 @@
+#ifndef SUMMEREX6_SEQLOCKHASHMAP_HPP
+#define SUMMEREX6_SEQLOCKHASHMAP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include "CacheAligned.hpp"
+#include "EpochReclaimer.hpp"
+#include "HashMix.hpp"
+
+/**
+ * a thread safe associative container for small trivially copyable keys and values, such as counters and offsets,
+ * whose readers write no shared memory at all.
+ * the keys are partitioned into segments, and every segment is an open addressing table guarded by a sequence
+ * counter. a writer locks the segment and makes the counter odd while it changes the table. a reader copies what it
+ * needs without locking and retries if the counter was odd or changed meanwhile. the slots are arrays of atomic words
+ * so the racing copies are well defined, and tables replaced by a resize are freed through an EpochReclaimer.
+ * @tparam KeyT - key of each pair, trivially copyable.
+ * @tparam ValueT - value of each pair, trivially copyable.
+ * @tparam Hash - hash function of the keys.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class SeqlockHashMap
+{
+    static_assert(std::is_trivially_copyable<KeyT>::value && std::is_trivially_copyable<ValueT>::value,
+                  "seqlock reads require trivially copyable keys and values.");
+
+private:
+    typedef std::atomic<uint64_t> Word;
+
+    /**
+     * layout of a slot: a tag word holding the hash code with its highest bit set, 0 for an empty slot, followed by
+     * the words of the key and the words of the value.
+     */
+    enum : size_t
+    {
+        kKeyWords = (sizeof(KeyT) + sizeof(uint64_t) - 1) / sizeof(uint64_t),
+        kValueWords = (sizeof(ValueT) + sizeof(uint64_t) - 1) / sizeof(uint64_t),
+        kSlotWords = 1 + kKeyWords + kValueWords,
+        kInitialCapacity = 16
+    };
+
+    /**
+     * an array of slots, its capacity is a power of two.
+     */
+    struct Table
+    {
+        size_t capacity;
+        Word* words;
+
+        explicit Table(size_t cap): capacity(cap), words(new Word[cap * kSlotWords])
+        {
+            for (size_t i = 0; i < cap * kSlotWords; ++i)
+            {
+                words[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        Table(const Table&) = delete;
+
+        Table& operator =(const Table&) = delete;
+
+        ~Table()
+        {
+            delete [] words;
+        }
+
+        Word* slot(size_t index) const
+        {
+            return words + index * kSlotWords;
+        }
+    };
+
+    /**
+     * a part of the map with its sequence counter. the counter starts a cache line, and the segment fills whole
+     * cache lines, so the counters of neighbouring segments never share one.
+     */
+    struct Segment: public CacheAligned
+    {
+        alignas(CacheAligned::kCacheLine) Word sequence;
+        std::atomic<Table*> table;
+        std::atomic<size_t> size;
+        std::mutex writeLock;
+
+        Segment(): sequence(0), table(new Table(kInitialCapacity)), size(0)
+        {
+
+        }
+
+        ~Segment()
+        {
+            delete table.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * load factor above which a segment table is doubled.
+     */
+    double upperThreshold;
+
+    /**
+     * the segments, their number is a power of two.
+     */
+    std::unique_ptr<std::unique_ptr<Segment>[]> _segments;
+
+    /**
+     * number of segments.
+     */
+    size_t _numOfSegments;
+
+    /**
+     * frees the tables replaced by resizes.
+     */
+    mutable EpochReclaimer _reclaimer;
+
+    /**
+     * copy an object out of words that may be written concurrently.
+     * @param words - the words.
+     * @param object - the object to copy to.
+     * @param bytes - size of the object.
+     */
+    static void _loadWords(const Word* words, void* object, size_t bytes)
+    {
+        char* target = static_cast<char*>(object);
+        for (size_t offset = 0; offset < bytes; offset += sizeof(uint64_t))
+        {
+            uint64_t word = words[offset / sizeof(uint64_t)].load(std::memory_order_relaxed);
+            std::memcpy(target + offset, &word, std::min(sizeof(uint64_t), bytes - offset));
+        }
+    }
+
+    /**
+     * copy an object into words that may be read concurrently.
+     * @param words - the words.
+     * @param object - the object to copy from.
+     * @param bytes - size of the object.
+     */
+    static void _storeWords(Word* words, const void* object, size_t bytes)
+    {
+        const char* source = static_cast<const char*>(object);
+        for (size_t offset = 0; offset < bytes; offset += sizeof(uint64_t))
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, source + offset, std::min(sizeof(uint64_t), bytes - offset));
+            words[offset / sizeof(uint64_t)].store(word, std::memory_order_relaxed);
+        }
+    }
+
+    static uint64_t _tag(size_t hash)
+    {
+        return (uint64_t) hash | (1ULL << 63);
+    }
+
+    static KeyT _keyOf(const Word* slot)
+    {
+        KeyT key;
+        _loadWords(slot + 1, &key, sizeof(KeyT));
+        return key;
+    }
+
+    static ValueT _valueOf(const Word* slot)
+    {
+        ValueT value;
+        _loadWords(slot + 1 + kKeyWords, &value, sizeof(ValueT));
+        return value;
+    }
+
+    /**
+     * get the segment of a hash code, selected by bits the tables do not use for their slots until they hold 2^48
+     * slots.
+     * @param hash - the mixed hash code.
+     * @return - the segment.
+     */
+    Segment& _segmentOf(size_t hash) const
+    {
+        return *_segments[(hash >> 48) & (_numOfSegments - 1)];
+    }
+
+    /**
+     * find the slot of a key, or the empty slot that ends its probe sequence.
+     * @param table - the table to search.
+     * @param hash - the mixed hash code of the key.
+     * @param key - the key to look for.
+     * @param found - set to whether the key was found.
+     * @return - index of the slot.
+     */
+    size_t _probe(const Table* table, size_t hash, const KeyT& key, bool& found) const
+    {
+        size_t mask = table->capacity - 1;
+        uint64_t tag = _tag(hash);
+        for (size_t index = hash & mask, step = 0; step <= mask; index = (index + 1) & mask, ++step)
+        {
+            const Word* slot = table->slot(index);
+            uint64_t slotTag = slot[0].load(std::memory_order_relaxed);
+            if (slotTag == 0)
+            {
+                found = false;
+                return index;
+            }
+            if (slotTag == tag && _keyEqual(_keyOf(slot), key))
+            {
+                found = true;
+                return index;
+            }
+        }
+        found = false;
+        return table->capacity;
+    }
+
+    /**
+     * read the value of a key without locking, retrying until no writer interfered.
+     * @param key - the key to look for.
+     * @param value - set to the value if the key was found.
+     * @return - true if the key was found.
+     */
+    bool _read(const KeyT& key, ValueT& value) const
+    {
+        size_t hash = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(hash);
+        EpochReclaimer::Guard guard(_reclaimer);
+        while (true)
+        {
+            uint64_t before = segment.sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                continue;
+            }
+            const Table* table = segment.table.load(std::memory_order_acquire);
+            bool found;
+            size_t index = _probe(table, hash, key, found);
+            ValueT copy;
+            if (found)
+            {
+                copy = _valueOf(table->slot(index));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment.sequence.load(std::memory_order_relaxed) == before)
+            {
+                if (found)
+                {
+                    value = copy;
+                }
+                return found;
+            }
+        }
+    }
+
+    /**
+     * start changing a segment, the writeLock of the segment must be held.
+     * @param segment - the segment.
+     */
+    static void _beginWrite(Segment& segment)
+    {
+        segment.sequence.store(segment.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /**
+     * finish changing a segment.
+     * @param segment - the segment.
+     */
+    static void _endWrite(Segment& segment)
+    {
+        segment.sequence.store(segment.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * a write to a segment, from construction to destruction, so the sequence counter is made even again even if
+     * the write is left by an exception. nothing that may throw should run inside it, since readers spin meanwhile.
+     */
+    class WriteSection
+    {
+    private:
+        Segment& _segment;
+
+    public:
+        explicit WriteSection(Segment& segment): _segment(segment)
+        {
+            _beginWrite(_segment);
+        }
+
+        WriteSection(const WriteSection&) = delete;
+
+        WriteSection& operator =(const WriteSection&) = delete;
+
+        ~WriteSection()
+        {
+            _endWrite(_segment);
+        }
+    };
+
+    /**
+     * write a key and a value into a slot.
+     */
+    static void _fill(Word* slot, uint64_t tag, const KeyT& key, const ValueT& value)
+    {
+        _storeWords(slot + 1, &key, sizeof(KeyT));
+        _storeWords(slot + 1 + kKeyWords, &value, sizeof(ValueT));
+        slot[0].store(tag, std::memory_order_relaxed);
+    }
+
+    /**
+     * publish a segment table of double the capacity and retire the current one. the writeLock of the segment must
+     * be held, but no write is needed: the current table is not changed, so readers that still use it read correct
+     * data, and the write that then adds an element to the new table makes them retry.
+     * @param segment - the segment.
+     */
+    void _increaseTableSize(Segment& segment)
+    {
+        Table* current = segment.table.load(std::memory_order_relaxed);
+        Table* updated = new Table(current->capacity * 2);
+        size_t mask = updated->capacity - 1;
+        for (size_t i = 0; i < current->capacity; ++i)
+        {
+            const Word* slot = current->slot(i);
+            uint64_t tag = slot[0].load(std::memory_order_relaxed);
+            if (tag == 0)
+            {
+                continue;
+            }
+            size_t index = (size_t) tag & mask;
+            while (updated->slot(index)[0].load(std::memory_order_relaxed) != 0)
+            {
+                index = (index + 1) & mask;
+            }
+            Word* target = updated->slot(index);
+            for (size_t w = 0; w < kSlotWords; ++w)
+            {
+                target[w].store(slot[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+        segment.table.store(updated, std::memory_order_release);
+        _reclaimer.retire(current);
+    }
+
+    /**
+     * find the slot of a key for a writer, or the slot to add it in, growing the table first if the key is not there
+     * and the table is full. it runs before the write, so an allocation that throws leaves the segment readable.
+     * @param segment - the segment of the key, its writeLock must be held.
+     * @param hash - the mixed hash code of the key.
+     * @param key - the key.
+     * @param found - set to whether the key is in the table.
+     * @return - the slot of the key, or the empty slot to add it in.
+     */
+    Word* _prepareSlot(Segment& segment, size_t hash, const KeyT& key, bool& found)
+    {
+        Table* table = segment.table.load(std::memory_order_relaxed);
+        size_t index = _probe(table, hash, key, found);
+        if (!found && (double) (segment.size.load(std::memory_order_relaxed) + 1) / (double) table->capacity >
+                      upperThreshold)
+        {
+            _increaseTableSize(segment);
+            table = segment.table.load(std::memory_order_relaxed);
+            index = _probe(table, hash, key, found);
+        }
+        return table->slot(index);
+    }
+
+    /**
+     * add a key to the empty slot found by _prepareSlot. the segment must be in a write.
+     */
+    static void _add(Segment& segment, Word* slot, size_t hash, const KeyT& key, const ValueT& value)
+    {
+        _fill(slot, _tag(hash), key, value);
+        segment.size.store(segment.size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+public:
+    /**
+     * a constructor.
+     * @param concurrencyLevel - expected number of threads that update the map at once, rounded up to a power of two
+     * to get the number of segments.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit SeqlockHashMap(size_t concurrencyLevel = 64, const Hash& hash = Hash(),
+                            const KeyEqual& keyEqual = KeyEqual()): _hasher(hash), _keyEqual(keyEqual),
+                            upperThreshold(0.7), _numOfSegments(1)
+    {
+        if (concurrencyLevel == 0 || concurrencyLevel > (1 << 16))
+        {
+            throw std::invalid_argument("concurrency level must be between 1 and 65536.");
+        }
+        while (_numOfSegments < concurrencyLevel)
+        {
+            _numOfSegments *= 2;
+        }
+        _segments.reset(new std::unique_ptr<Segment>[_numOfSegments]);
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            _segments[i].reset(new Segment());
+        }
+    }
+
+    SeqlockHashMap(const SeqlockHashMap&) = delete;
+
+    SeqlockHashMap& operator =(const SeqlockHashMap&) = delete;
+
+    /**
+     * get the number of elements, the segments are counted one after the other.
+     * @return - the number of elements.
+     */
+    size_t size() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < _numOfSegments; ++i)
+        {
+            total += _segments[i]->size.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     * check if the map is empty.
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * checks if the container contains element with specific key, without writing shared memory.
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key) const
+    {
+        ValueT ignored;
+        return _read(key, ignored);
+    }
+
+    /**
+     * Returns a copy of the value mapped to key, without writing shared memory. If no such element exists, an
+     * exception of type std::out_of_range is thrown.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the requested element.
+     */
+    ValueT at(const KeyT& key) const
+    {
+        ValueT value;
+        if (!_read(key, value))
+        {
+            throw std::out_of_range("Hash map does not contain the given key.");
+        }
+        return value;
+    }
+
+    /**
+     * copy the value mapped to key if there is one, without writing shared memory.
+     * @param key - the key of the element to find.
+     * @param value - set to the mapped value if the key was found.
+     * @return - true if the key was found, false otherwise.
+     */
+    bool find(const KeyT& key, ValueT& value) const
+    {
+        return _read(key, value);
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        size_t hash = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(hash);
+        std::lock_guard<std::mutex> lock(segment.writeLock);
+        bool found;
+        Word* slot = _prepareSlot(segment, hash, key, found);
+        if (found)
+        {
+            return false;
+        }
+        WriteSection write(segment);
+        _add(segment, slot, hash, key, value);
+        return true;
+    }
+
+    /**
+     * Assigns value to the element with the given key, or inserts a new element if there is no such key.
+     * @param key - key to assign to.
+     * @param value - value to assign.
+     * @return - true if the insertion took place, false if the assignment took place.
+     */
+    bool insert_or_assign(const KeyT& key, const ValueT& value)
+    {
+        size_t hash = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(hash);
+        std::lock_guard<std::mutex> lock(segment.writeLock);
+        bool found;
+        Word* slot = _prepareSlot(segment, hash, key, found);
+        WriteSection write(segment);
+        if (found)
+        {
+            _storeWords(slot + 1 + kKeyWords, &value, sizeof(ValueT));
+        }
+        else
+        {
+            _add(segment, slot, hash, key, value);
+        }
+        return !found;
+    }
+
+    /**
+     * change the value mapped to key with a function, inserting a value initialized ValueT first if the key is not
+     * in the map yet. readers see either the old or the new value.
+     * @tparam Function - type of the function, callable with ValueT&.
+     * @param key - the key of the element to update.
+     * @param function - the function to call, it must not access the map. it is called on a copy of the value
+     * before the write starts, so if it throws the map is left unchanged.
+     * @return - the updated value.
+     */
+    template<typename Function>
+    ValueT update(const KeyT& key, Function function)
+    {
+        size_t hash = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(hash);
+        std::lock_guard<std::mutex> lock(segment.writeLock);
+        bool found;
+        Word* slot = _prepareSlot(segment, hash, key, found);
+        ValueT value = found ? _valueOf(slot) : ValueT();
+        function(value);
+        WriteSection write(segment);
+        if (found)
+        {
+            _storeWords(slot + 1 + kKeyWords, &value, sizeof(ValueT));
+        }
+        else
+        {
+            _add(segment, slot, hash, key, value);
+        }
+        return value;
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key. the following elements of its probe
+     * sequence are shifted back, so the table never holds deleted markers.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        size_t hash = mix_hash(_hasher(key));
+        Segment& segment = _segmentOf(hash);
+        std::lock_guard<std::mutex> lock(segment.writeLock);
+        Table* table = segment.table.load(std::memory_order_relaxed);
+        bool found;
+        size_t hole = _probe(table, hash, key, found);
+        if (!found)
+        {
+            return false;
+        }
+        WriteSection write(segment);
+        size_t mask = table->capacity - 1;
+        for (size_t index = (hole + 1) & mask; ; index = (index + 1) & mask)
+        {
+            Word* slot = table->slot(index);
+            uint64_t tag = slot[0].load(std::memory_order_relaxed);
+            if (tag == 0)
+            {
+                break;
+            }
+            size_t home = (size_t) tag & mask;
+            if (((index - home) & mask) >= ((index - hole) & mask))
+            {
+                Word* target = table->slot(hole);
+                for (size_t w = 0; w < kSlotWords; ++w)
+                {
+                    target[w].store(slot[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                hole = index;
+            }
+        }
+        table->slot(hole)[0].store(0, std::memory_order_relaxed);
+        segment.size.store(segment.size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+
+#endif //SUMMEREX6_SEQLOCKHASHMAP_HPP
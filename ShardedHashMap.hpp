@@ -0,0 +1,128 @@
+#ifndef SUMMEREX6_SHARDEDHASHMAP_HPP
+#define SUMMEREX6_SHARDEDHASHMAP_HPP
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "HashMap.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * a set of independent maps, one per thread, that are filled without any synchronization and later combined into a
+ * single map. every shard stores the hash codes of its keys, so combining them calls no hash function.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class ShardedHashMap
+{
+public:
+    typedef HashMap<KeyT, ValueT, Hash, KeyEqual, true> Shard;
+
+private:
+    /**
+     * the shards, allocated one by one so shards used by different threads do not share cache lines.
+     */
+    std::vector<std::unique_ptr<Shard>> _shards;
+
+public:
+    /**
+     * a constructor.
+     * @param numOfShards - number of shards, usually the number of threads that fill the map.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit ShardedHashMap(size_t numOfShards, const Hash& hash = Hash(), const KeyEqual& keyEqual = KeyEqual())
+    {
+        if (numOfShards == 0)
+        {
+            throw std::invalid_argument("a sharded map needs at least one shard.");
+        }
+        for (size_t i = 0; i < numOfShards; ++i)
+        {
+            _shards.emplace_back(new Shard(hash, keyEqual));
+        }
+    }
+
+    /**
+     * get the number of shards.
+     * @return - the number of shards.
+     */
+    size_t shard_count() const
+    {
+        return _shards.size();
+    }
+
+    /**
+     * get a shard. a shard may be used by one thread at a time, different shards by different threads at once.
+     * @param index - index of the shard.
+     * @return - the shard.
+     */
+    Shard& shard(size_t index)
+    {
+        if (index >= _shards.size())
+        {
+            throw std::out_of_range("no shard with the given index.");
+        }
+        return *_shards[index];
+    }
+
+    /**
+     * get the total number of elements of the shards, a key that is in several shards is counted once for each.
+     * @return - the number of elements.
+     */
+    size_t size() const
+    {
+        size_t total = 0;
+        for (const std::unique_ptr<Shard>& shard : _shards)
+        {
+            total += shard->size();
+        }
+        return total;
+    }
+
+    /**
+     * add the elements of all shards to a map, combining the values of keys that appear more than once. the target
+     * is first grown to fit the largest shard, then its buckets are split between the threads of the pool, every
+     * bucket collecting its elements straight from the shard buckets that map to it, and it is resized once more at
+     * the end if the merged elements exceed its upper threshold. the shards are left unchanged.
+     * no thread may use the shards or the target during the merge.
+     * @tparam Combiner - type of the combiner, callable with ValueT& and const ValueT&.
+     * @param target - the map to add the elements to, it may already hold elements.
+     * @param combine - called with the value in the target and the value being added when a key is already present,
+     * it is called from several threads at once but never for the same key.
+     * @param pool - the pool, or nullptr to merge on the calling thread.
+     */
+    template<typename Combiner>
+    void merge_into(Shard& target, Combiner combine, ThreadPool* pool = nullptr)
+    {
+        std::vector<const Shard*> sources;
+        for (std::unique_ptr<Shard>& shard : _shards)
+        {
+            if (shard.get() == &target)
+            {
+                throw std::invalid_argument("a shard cannot be merged into itself.");
+            }
+            shard->_finishRehash();
+            sources.push_back(shard.get());
+        }
+        target._combine(sources.data(), sources.size(), combine, pool);
+    }
+
+    /**
+     * Erases all elements from all shards.
+     */
+    void clear()
+    {
+        for (std::unique_ptr<Shard>& shard : _shards)
+        {
+            shard->clear();
+        }
+    }
+};
+
+
+#endif //SUMMEREX6_SHARDEDHASHMAP_HPP
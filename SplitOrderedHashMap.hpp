@@ -0,0 +1,573 @@
+#ifndef SUMMEREX6_SPLITORDEREDHASHMAP_HPP
+#define SUMMEREX6_SPLITORDEREDHASHMAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include "EpochReclaimer.hpp"
+#include "HashMix.hpp"
+
+using std::pair;
+
+/**
+ * a lock free associative container. all elements are kept in a single sorted linked list, ordered by the bit
+ * reversed hash codes of their keys, so the elements of bucket i of a table with capacity c are a contiguous run
+ * that starts at a dummy node, and doubling the capacity only splits runs by inserting dummy nodes for the new
+ * buckets. no element is ever moved.
+ * insertion, removal and lookup use compare-and-swap only. removed nodes are freed through an EpochReclaimer.
+ * values cannot be changed once inserted, since a reader could be copying them; erase and insert a key to change it.
+ * @tparam KeyT - key of each pair.
+ * @tparam ValueT - value of each pair.
+ * @tparam Hash - hash function of the keys.
+ * @tparam KeyEqual - equality of the keys.
+ */
+template<typename KeyT, typename ValueT, typename Hash = std::hash<KeyT>, typename KeyEqual = std::equal_to<KeyT>>
+class SplitOrderedHashMap
+{
+private:
+    enum : size_t
+    {
+        kInitialCapacity = 16,
+        kMaxLoad = 2,
+        kNumOfSegments = 64
+    };
+
+    /**
+     * a node of the list. the lowest bit of next marks a node that is being removed. dummy nodes have an even order
+     * key, element nodes an odd one.
+     */
+    struct Node
+    {
+        uint64_t orderKey;
+        std::atomic<uintptr_t> next;
+
+        explicit Node(uint64_t key): orderKey(key), next(0)
+        {
+
+        }
+
+        bool isDummy() const
+        {
+            return (orderKey & 1) == 0;
+        }
+    };
+
+    /**
+     * a node that holds an element.
+     */
+    struct ElementNode: public Node
+    {
+        pair<KeyT, ValueT> element;
+
+        ElementNode(uint64_t key, const KeyT& k, const ValueT& v): Node(key), element(k, v)
+        {
+
+        }
+    };
+
+    /**
+     * the position found by _find: prev points to curr, which is the first node not ordered before the looked up key.
+     */
+    struct Window
+    {
+        std::atomic<uintptr_t>* prev;
+        Node* curr;
+        uintptr_t next;
+    };
+
+    /**
+     * hash function of the keys.
+     */
+    Hash _hasher;
+
+    /**
+     * equality of the keys.
+     */
+    KeyEqual _keyEqual;
+
+    /**
+     * the dummy nodes of the buckets, in segments allocated on demand. segment 0 holds bucket 0 and segment s > 0
+     * holds the 2^(s-1) buckets starting at 2^(s-1), so existing buckets stay in place when the capacity grows.
+     */
+    std::atomic<std::atomic<Node*>*> _segments[kNumOfSegments];
+
+    /**
+     * number of buckets, a power of two.
+     */
+    std::atomic<size_t> _capacity;
+
+    /**
+     * number of elements.
+     */
+    std::atomic<size_t> _size;
+
+    /**
+     * frees the removed nodes.
+     */
+    mutable EpochReclaimer _reclaimer;
+
+    static Node* _pointer(uintptr_t link)
+    {
+        return reinterpret_cast<Node*>(link & ~(uintptr_t) 1);
+    }
+
+    static bool _isMarked(uintptr_t link)
+    {
+        return (link & 1) != 0;
+    }
+
+    /**
+     * reverse the bits of a 64 bit number.
+     * @param v - the number.
+     * @return - the number with its bits reversed.
+     */
+    static uint64_t _reverse(uint64_t v)
+    {
+        v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+        v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+        v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+        v = ((v >> 16) & 0x0000FFFF0000FFFFULL) | ((v & 0x0000FFFF0000FFFFULL) << 16);
+        return (v >> 32) | (v << 32);
+    }
+
+    /**
+     * get the number of bits needed to write a number, which is also the segment of the bucket with that index.
+     * @param v - the number.
+     * @return - the index of the highest set bit plus one, 0 for 0.
+     */
+    static size_t _bitWidth(uint64_t v)
+    {
+        if (v == 0)
+        {
+            return 0;
+        }
+#if defined(__GNUC__) || defined(__clang__)
+        return 64 - __builtin_clzll(v);
+#else
+        size_t width = 0;
+        while (v != 0)
+        {
+            v >>= 1;
+            width++;
+        }
+        return width;
+#endif
+    }
+
+    /**
+     * get the order key of an element, the highest bit of the hash becomes the lowest bit of the key and is set.
+     * @param hash - hash code of the key.
+     * @return - the order key.
+     */
+    static uint64_t _elementKey(size_t hash)
+    {
+        return _reverse((uint64_t) hash | (1ULL << 63));
+    }
+
+    /**
+     * get the order key of the dummy node of a bucket.
+     * @param bucket - index of the bucket.
+     * @return - the order key.
+     */
+    static uint64_t _dummyKey(size_t bucket)
+    {
+        return _reverse((uint64_t) bucket);
+    }
+
+    /**
+     * get the bucket a bucket splits from, by clearing its highest bit.
+     * @param bucket - index of the bucket, not 0.
+     * @return - index of the parent bucket.
+     */
+    static size_t _parent(size_t bucket)
+    {
+        return bucket & ~((size_t) 1 << (_bitWidth(bucket) - 1));
+    }
+
+    /**
+     * get the slot that holds the dummy node of a bucket, allocating its segment if needed.
+     * @param bucket - index of the bucket.
+     * @return - the slot.
+     */
+    std::atomic<Node*>& _slot(size_t bucket)
+    {
+        size_t segment = _bitWidth(bucket);
+        size_t segmentSize = segment == 0 ? 1 : (size_t) 1 << (segment - 1);
+        std::atomic<Node*>* slots = _segments[segment].load(std::memory_order_acquire);
+        if (slots == nullptr)
+        {
+            std::atomic<Node*>* allocated = new std::atomic<Node*>[segmentSize];
+            for (size_t i = 0; i < segmentSize; ++i)
+            {
+                allocated[i].store(nullptr, std::memory_order_relaxed);
+            }
+            if (_segments[segment].compare_exchange_strong(slots, allocated, std::memory_order_acq_rel))
+            {
+                slots = allocated;
+            }
+            else
+            {
+                delete [] allocated;
+            }
+        }
+        return slots[segment == 0 ? 0 : bucket - segmentSize];
+    }
+
+    /**
+     * find the position of an order key in the list, unlinking the marked nodes on the way.
+     * @param head - node to start from, ordered before the key.
+     * @param orderKey - the order key to look for.
+     * @param key - the key of the element, nullptr to look for a dummy node.
+     * @param window - set to the position of the key.
+     * @return - true if a node with the key was found, it is then window.curr.
+     */
+    bool _find(Node* head, uint64_t orderKey, const KeyT* key, Window& window) const
+    {
+        while (true)
+        {
+            bool restart = false;
+            window.prev = &head->next;
+            window.curr = _pointer(window.prev->load(std::memory_order_acquire));
+            while (window.curr != nullptr)
+            {
+                window.next = window.curr->next.load(std::memory_order_acquire);
+                if (window.prev->load(std::memory_order_acquire) != reinterpret_cast<uintptr_t>(window.curr))
+                {
+                    restart = true;
+                    break;
+                }
+                if (_isMarked(window.next))
+                {
+                    uintptr_t expected = reinterpret_cast<uintptr_t>(window.curr);
+                    uintptr_t successor = reinterpret_cast<uintptr_t>(_pointer(window.next));
+                    if (!window.prev->compare_exchange_strong(expected, successor))
+                    {
+                        restart = true;
+                        break;
+                    }
+                    _reclaimer.retire(static_cast<ElementNode*>(window.curr));
+                    window.curr = _pointer(successor);
+                    continue;
+                }
+                if (window.curr->orderKey > orderKey)
+                {
+                    return false;
+                }
+                if (window.curr->orderKey == orderKey && (key == nullptr ||
+                    _keyEqual(static_cast<ElementNode*>(window.curr)->element.first, *key)))
+                {
+                    return true;
+                }
+                window.prev = &window.curr->next;
+                window.curr = _pointer(window.next);
+            }
+            if (!restart)
+            {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * get the dummy node of a bucket, inserting it and the dummy nodes of its ancestors if needed.
+     * @param bucket - index of the bucket.
+     * @return - the dummy node.
+     */
+    Node* _bucketHead(size_t bucket)
+    {
+        std::atomic<Node*>& slot = _slot(bucket);
+        Node* head = slot.load(std::memory_order_acquire);
+        if (head != nullptr)
+        {
+            return head;
+        }
+        Node* parent = _bucketHead(_parent(bucket));
+        Node* dummy = new Node(_dummyKey(bucket));
+        Window window;
+        while (true)
+        {
+            if (_find(parent, dummy->orderKey, nullptr, window))
+            {
+                delete dummy;
+                dummy = window.curr;
+                break;
+            }
+            dummy->next.store(reinterpret_cast<uintptr_t>(window.curr), std::memory_order_relaxed);
+            uintptr_t expected = reinterpret_cast<uintptr_t>(window.curr);
+            if (window.prev->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(dummy)))
+            {
+                break;
+            }
+        }
+        slot.store(dummy, std::memory_order_release);
+        return dummy;
+    }
+
+    /**
+     * get the dummy node of the bucket of a hash code, for readers that must not allocate. a bucket that was not
+     * initialized yet is searched from its closest initialized ancestor.
+     * @param hash - hash code of the key.
+     * @return - the dummy node.
+     */
+    Node* _readHead(size_t hash) const
+    {
+        size_t bucket = hash & (_capacity.load(std::memory_order_acquire) - 1);
+        while (true)
+        {
+            size_t segment = _bitWidth(bucket);
+            size_t segmentSize = segment == 0 ? 1 : (size_t) 1 << (segment - 1);
+            std::atomic<Node*>* slots = _segments[segment].load(std::memory_order_acquire);
+            if (slots != nullptr)
+            {
+                Node* head = slots[segment == 0 ? 0 : bucket - segmentSize].load(std::memory_order_acquire);
+                if (head != nullptr)
+                {
+                    return head;
+                }
+            }
+            bucket = _parent(bucket);
+        }
+    }
+
+    /**
+     * find the element of a key inside an epoch.
+     * @param key - the key to look for.
+     * @return - the element, or nullptr if there is none.
+     */
+    const ElementNode* _lookup(const KeyT& key) const
+    {
+        size_t hash = mix_hash(_hasher(key));
+        Window window;
+        if (_find(_readHead(hash), _elementKey(hash), &key, window))
+        {
+            return static_cast<const ElementNode*>(window.curr);
+        }
+        return nullptr;
+    }
+
+public:
+    /**
+     * a constructor.
+     * @param hash - hash function of the keys.
+     * @param keyEqual - equality of the keys.
+     */
+    explicit SplitOrderedHashMap(const Hash& hash = Hash(), const KeyEqual& keyEqual = KeyEqual()): _hasher(hash),
+            _keyEqual(keyEqual), _capacity(kInitialCapacity), _size(0)
+    {
+        for (size_t i = 0; i < kNumOfSegments; ++i)
+        {
+            _segments[i].store(nullptr, std::memory_order_relaxed);
+        }
+        _slot(0).store(new Node(_dummyKey(0)), std::memory_order_relaxed);
+    }
+
+    SplitOrderedHashMap(const SplitOrderedHashMap&) = delete;
+
+    SplitOrderedHashMap& operator =(const SplitOrderedHashMap&) = delete;
+
+    /**
+     * frees all nodes, no thread may use the map anymore.
+     */
+    ~SplitOrderedHashMap()
+    {
+        Node* node = _slot(0).load(std::memory_order_relaxed);
+        while (node != nullptr)
+        {
+            Node* next = _pointer(node->next.load(std::memory_order_relaxed));
+            if (node->isDummy())
+            {
+                delete node;
+            }
+            else
+            {
+                delete static_cast<ElementNode*>(node);
+            }
+            node = next;
+        }
+        for (size_t i = 0; i < kNumOfSegments; ++i)
+        {
+            delete [] _segments[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * get the number of elements the map currently contains.
+     * @return - the number of elements.
+     */
+    size_t size() const
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * get the number of buckets.
+     * @return - the capacity.
+     */
+    size_t capacity() const
+    {
+        return _capacity.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * check if the map is empty.
+     * @return - true or false.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * Inserts element into the container, if the container doesn't already contain an element with an equivalent key.
+     * the capacity is doubled once the average bucket holds more than kMaxLoad elements.
+     * @param key - key to insert.
+     * @param value - value to insert.
+     * @return - a bool denoting whether the insertion took place.
+     */
+    bool insert(const KeyT& key, const ValueT& value)
+    {
+        size_t hash = mix_hash(_hasher(key));
+        EpochReclaimer::Guard guard(_reclaimer);
+        size_t cap = _capacity.load(std::memory_order_acquire);
+        Node* head = _bucketHead(hash & (cap - 1));
+        ElementNode* node = new ElementNode(_elementKey(hash), key, value);
+        Window window;
+        while (true)
+        {
+            if (_find(head, node->orderKey, &key, window))
+            {
+                delete node;
+                return false;
+            }
+            node->next.store(reinterpret_cast<uintptr_t>(window.curr), std::memory_order_relaxed);
+            uintptr_t expected = reinterpret_cast<uintptr_t>(window.curr);
+            if (window.prev->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node)))
+            {
+                break;
+            }
+        }
+        size_t updatedSize = _size.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (updatedSize > cap * kMaxLoad && cap < ((size_t) 1 << 62))
+        {
+            _capacity.compare_exchange_strong(cap, cap * 2);
+        }
+        return true;
+    }
+
+    /**
+     * checks if the container contains element with specific key
+     * @param key - key value of the element to search for.
+     * @return - true if there is such an element, otherwise false.
+     */
+    bool contains_key(const KeyT& key) const
+    {
+        EpochReclaimer::Guard guard(_reclaimer);
+        return _lookup(key) != nullptr;
+    }
+
+    /**
+     * Returns a copy of the value mapped to key. If no such element exists, an exception of type std::out_of_range is
+     * thrown.
+     * @param key - the key of the element to find.
+     * @return - the mapped value of the requested element.
+     */
+    ValueT at(const KeyT& key) const
+    {
+        EpochReclaimer::Guard guard(_reclaimer);
+        const ElementNode* node = _lookup(key);
+        if (node == nullptr)
+        {
+            throw std::out_of_range("Hash map does not contain the given key.");
+        }
+        return node->element.second;
+    }
+
+    /**
+     * copy the value mapped to key, if there is one.
+     * @param key - the key of the element to find.
+     * @param value - set to the mapped value if the key was found.
+     * @return - true if the key was found, false otherwise.
+     */
+    bool find(const KeyT& key, ValueT& value) const
+    {
+        EpochReclaimer::Guard guard(_reclaimer);
+        const ElementNode* node = _lookup(key);
+        if (node == nullptr)
+        {
+            return false;
+        }
+        value = node->element.second;
+        return true;
+    }
+
+    /**
+     * Removes the element (if one exists) with the key equivalent to key. the node is first marked, which removes it
+     * logically, and then unlinked by this thread or by the next thread that passes over it.
+     * @param key - key value of the elements to remove
+     * @return - true if removed successfully, false otherwise.
+     */
+    bool erase(const KeyT& key)
+    {
+        size_t hash = mix_hash(_hasher(key));
+        uint64_t orderKey = _elementKey(hash);
+        EpochReclaimer::Guard guard(_reclaimer);
+        Node* head = _bucketHead(hash & (_capacity.load(std::memory_order_acquire) - 1));
+        Window window;
+        while (true)
+        {
+            if (!_find(head, orderKey, &key, window))
+            {
+                return false;
+            }
+            if (_isMarked(window.next))
+            {
+                continue;
+            }
+            uintptr_t expected = window.next;
+            if (!window.curr->next.compare_exchange_strong(expected, window.next | 1))
+            {
+                continue;
+            }
+            expected = reinterpret_cast<uintptr_t>(window.curr);
+            if (window.prev->compare_exchange_strong(expected, window.next))
+            {
+                _reclaimer.retire(static_cast<ElementNode*>(window.curr));
+            }
+            else
+            {
+                _find(head, orderKey, &key, window);
+            }
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    /**
+     * call a function on every element, in the order of the list. elements inserted or removed during the call may
+     * or may not be visited.
+     * @tparam Function - type of the function, callable with const pair<KeyT, ValueT>&.
+     * @param function - the function to call.
+     */
+    template<typename Function>
+    void for_each(Function function) const
+    {
+        EpochReclaimer::Guard guard(_reclaimer);
+        const Node* node = _readHead(0);
+        while (node != nullptr)
+        {
+            uintptr_t next = node->next.load(std::memory_order_acquire);
+            if (!node->isDummy() && !_isMarked(next))
+            {
+                function(static_cast<const ElementNode*>(node)->element);
+            }
+            node = _pointer(next);
+        }
+    }
+};
+
+
+#endif //SUMMEREX6_SPLITORDEREDHASHMAP_HPP
@@ -0,0 +1,64 @@
+#ifndef SUMMEREX6_THREADINDEX_HPP
+#define SUMMEREX6_THREADINDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+/**
+ * a small index for every thread, so the concurrent maps can give each thread a slot of its own in a fixed array.
+ * indices are shared by all maps of the process, and an index is reused once the thread that held it exits.
+ */
+class ThreadIndex
+{
+public:
+    enum : size_t
+    {
+        kMaxThreads = 256
+    };
+
+private:
+    size_t _index;
+
+    static std::atomic<bool>* _used()
+    {
+        static std::atomic<bool> used[kMaxThreads] = {};
+        return used;
+    }
+
+    ThreadIndex(): _index(0)
+    {
+        std::atomic<bool>* used = _used();
+        while (_index < kMaxThreads && used[_index].exchange(true, std::memory_order_acquire))
+        {
+            _index++;
+        }
+        if (_index == kMaxThreads)
+        {
+            throw std::runtime_error("too many threads use the concurrent maps at once.");
+        }
+    }
+
+public:
+    ThreadIndex(const ThreadIndex&) = delete;
+
+    ThreadIndex& operator =(const ThreadIndex&) = delete;
+
+    ~ThreadIndex()
+    {
+        _used()[_index].store(false, std::memory_order_release);
+    }
+
+    /**
+     * get the index of the calling thread, assigning one on the first call.
+     * @return - an index less than kMaxThreads that no other running thread has.
+     */
+    static size_t current()
+    {
+        static thread_local ThreadIndex index;
+        return index._index;
+    }
+};
+
+
+#endif //SUMMEREX6_THREADINDEX_HPP
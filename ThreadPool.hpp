@@ -0,0 +1,204 @@
+#ifndef SUMMEREX6_THREADPOOL_HPP
+#define SUMMEREX6_THREADPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * a fixed set of worker threads that run loops over index ranges for the maps. the thread that calls parallel_for
+ * works on the loop as well, so a pool with no workers runs every loop on the calling thread.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _lock;
+    std::condition_variable _hasTask;
+    bool _stopping;
+
+    /**
+     * a loop shared by the calling thread and the workers that join it. chunks are claimed through next, and the
+     * caller waits until every worker that joined has left. a worker that picks the loop up after all chunks were
+     * claimed does not join it, so the caller never waits for workers that are busy elsewhere, and parallel_for may be
+     * called from inside a loop.
+     */
+    struct Loop
+    {
+        std::function<void(size_t, size_t)> body;
+        size_t end;
+        size_t grain;
+        std::atomic<size_t> next;
+        std::atomic<bool> failed;
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable done;
+        size_t active;
+
+        /**
+         * run chunks until none are left.
+         */
+        void work()
+        {
+            size_t begin;
+            while (!failed.load(std::memory_order_relaxed) &&
+                   (begin = next.fetch_add(grain, std::memory_order_relaxed)) < end)
+            {
+                try
+                {
+                    body(begin, std::min(end, begin + grain));
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!failed.exchange(true))
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        }
+    };
+
+    /**
+     * the loop of a worker thread.
+     */
+    void _run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> guard(_lock);
+                _hasTask.wait(guard, [this] { return _stopping || !_tasks.empty(); });
+                if (_tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    /**
+     * a constructor.
+     * @param numOfThreads - number of worker threads, the default leaves one hardware thread to the caller.
+     */
+    explicit ThreadPool(size_t numOfThreads = std::max(1u, std::thread::hardware_concurrency()) - 1):
+            _stopping(false)
+    {
+        for (size_t i = 0; i < numOfThreads; ++i)
+        {
+            _workers.emplace_back([this] { _run(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator =(const ThreadPool&) = delete;
+
+    /**
+     * finishes the queued tasks and joins the workers.
+     */
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stopping = true;
+        }
+        _hasTask.notify_all();
+        for (std::thread& worker : _workers)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * get the number of worker threads.
+     * @return - the number of workers, not counting the caller.
+     */
+    size_t size() const
+    {
+        return _workers.size();
+    }
+
+    /**
+     * call a function on disjoint chunks of a range of indices, on the calling thread and on the workers, and wait
+     * until all chunks are done. if a call throws, the remaining chunks are skipped and the first exception is
+     * rethrown.
+     * @tparam Function - type of the function, callable with the first and the past the last index of a chunk.
+     * @param begin - first index.
+     * @param end - past the last index.
+     * @param grain - number of indices in a chunk, at least 1.
+     * @param function - the function to call.
+     */
+    template<typename Function>
+    void parallel_for(size_t begin, size_t end, size_t grain, Function function)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        grain = std::max<size_t>(1, grain);
+        size_t chunks = (end - begin + grain - 1) / grain;
+        size_t helpers = std::min(_workers.size(), chunks - 1);
+        if (helpers == 0)
+        {
+            function(begin, end);
+            return;
+        }
+        std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+        loop->body = function;
+        loop->end = end;
+        loop->grain = grain;
+        loop->next.store(begin, std::memory_order_relaxed);
+        loop->failed.store(false, std::memory_order_relaxed);
+        loop->active = 0;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            for (size_t i = 0; i < helpers; ++i)
+            {
+                _tasks.emplace_back([loop]
+                {
+                    {
+                        std::lock_guard<std::mutex> join(loop->lock);
+                        if (loop->next.load(std::memory_order_relaxed) >= loop->end)
+                        {
+                            return;
+                        }
+                        loop->active++;
+                    }
+                    loop->work();
+                    std::lock_guard<std::mutex> leave(loop->lock);
+                    if (--loop->active == 0)
+                    {
+                        loop->done.notify_one();
+                    }
+                });
+            }
+        }
+        _hasTask.notify_all();
+        loop->work();
+        std::unique_lock<std::mutex> guard(loop->lock);
+        loop->done.wait(guard, [&loop] { return loop->active == 0; });
+        if (loop->error)
+        {
+            std::rethrow_exception(loop->error);
+        }
+    }
+};
+
+
+#endif //SUMMEREX6_THREADPOOL_HPP
@@ -0,0 +1,229 @@
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../ConcurrentHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * random operations compared with std::unordered_map, growing segments past several part splits.
+ */
+static void testRandomOperations()
+{
+    ConcurrentHashMap<int, long> map(4);
+    std::unordered_map<int, long> expected;
+    std::mt19937 random(11);
+    for (int i = 0; i < 300000; ++i)
+    {
+        int key = (int) (random() % 40000);
+        long value = (long) (random() % 1000);
+        switch (random() % 5)
+        {
+            case 0:
+                CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                break;
+            case 1:
+                CHECK(map.insert_or_assign(key, value) == (expected.count(key) == 0));
+                expected[key] = value;
+                break;
+            case 2:
+                map.update(key, [value](long& current)
+                {
+                    current += value;
+                });
+                expected[key] += value;
+                break;
+            case 3:
+                if (i % 3 == 0)
+                {
+                    CHECK(map.erase(key) == (expected.erase(key) == 1));
+                }
+                break;
+            default:
+            {
+                long found = 0;
+                bool contained = map.find(key, found);
+                CHECK(contained == (expected.count(key) == 1));
+                CHECK(!contained || (found == expected[key] && map.at(key) == found));
+            }
+        }
+    }
+    CHECK(map.size() == expected.size());
+    size_t visited = 0;
+    map.for_each([&expected, &visited](const pair<int, long>& element)
+    {
+        CHECK(expected.at(element.first) == element.second);
+        visited++;
+    });
+    CHECK(visited == expected.size());
+}
+
+/**
+ * writers on two segments insert, assign, erase and read keys of their own, which share segments and parts with the
+ * keys of the others, while all of them update a few shared counters. the segments grow past many part splits meanwhile,
+ * and the final contents must match a serial model made of the models of the writers and the counters.
+ */
+static void testConcurrentWriters()
+{
+    const int numOfThreads = 4;
+    const int numOfKeys = 80000;
+    const int numOfCounters = 64;
+    const int counterBase = 1000000;
+    const int perThread = 200000;
+    ConcurrentHashMap<int, long> map(2);
+    std::vector<std::unordered_map<int, long>> models(numOfThreads);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numOfThreads; ++t)
+    {
+        threads.emplace_back([&map, &models, &failed, t]
+        {
+            std::unordered_map<int, long>& model = models[t];
+            std::mt19937 random(t + 1);
+            for (int i = 0; i < perThread; ++i)
+            {
+                int key = (int) (random() % (numOfKeys / numOfThreads)) * numOfThreads + t;
+                long value = (long) (random() % 1000);
+                bool ok = true;
+                switch (random() % 6)
+                {
+                    case 0:
+                    case 1:
+                        ok = map.insert(key, value) == model.emplace(key, value).second;
+                        break;
+                    case 2:
+                        ok = map.insert_or_assign(key, value) == (model.count(key) == 0);
+                        model[key] = value;
+                        break;
+                    case 3:
+                        ok = map.erase(key) == (model.erase(key) == 1);
+                        break;
+                    case 4:
+                        map.update(counterBase + (int) (random() % numOfCounters), [](long& counter)
+                        {
+                            counter++;
+                        });
+                        break;
+                    default:
+                        try
+                        {
+                            long found = map.at(key);
+                            ok = model.count(key) == 1 && found == model[key];
+                        }
+                        catch (const std::out_of_range&)
+                        {
+                            ok = model.count(key) == 0;
+                        }
+                }
+                if (!ok)
+                {
+                    failed.store(true);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(!failed.load());
+    std::unordered_map<int, long> expected;
+    for (const std::unordered_map<int, long>& model : models)
+    {
+        expected.insert(model.begin(), model.end());
+    }
+    long updates = 0;
+    for (int counter = 0; counter < numOfCounters; ++counter)
+    {
+        long value = 0;
+        if (map.find(counterBase + counter, value))
+        {
+            expected[counterBase + counter] = value;
+            updates += value;
+        }
+    }
+    size_t numOfUpdates = 0;
+    for (int t = 0; t < numOfThreads; ++t)
+    {
+        std::mt19937 random(t + 1);
+        for (int i = 0; i < perThread; ++i)
+        {
+            random();
+            random();
+            if (random() % 6 == 4)
+            {
+                random();
+                numOfUpdates++;
+            }
+        }
+    }
+    CHECK((size_t) updates == numOfUpdates);
+    CHECK(map.size() == expected.size());
+    size_t visited = 0;
+    map.for_each([&expected, &visited](const pair<int, long>& element)
+    {
+        CHECK(expected.at(element.first) == element.second);
+        visited++;
+    });
+    CHECK(visited == expected.size());
+}
+
+/**
+ * a snapshot keeps the contents it was taken with while writers change the map, and outlives clear().
+ */
+static void testSnapshots()
+{
+    ConcurrentHashMap<int, long> map(8);
+    for (int key = 0; key < 20000; ++key)
+    {
+        map.insert(key, key);
+    }
+    ConcurrentHashMap<int, long>::Snapshot first = map.snapshot();
+    std::atomic<bool> stop(false);
+    std::thread writer([&map, &stop]
+    {
+        for (int key = 20000; !stop.load(); ++key)
+        {
+            map.insert(key, key);
+            map.erase(key - 20000);
+            map.update(key % 50, [](long& value)
+            {
+                value += 1000000;
+            });
+        }
+    });
+    for (int round = 0; round < 10; ++round)
+    {
+        ConcurrentHashMap<int, long>::Snapshot snapshot = map.snapshot();
+        size_t iterated = 0;
+        for (const pair<int, long>& element : snapshot)
+        {
+            CHECK(snapshot.contains_key(element.first) && snapshot.at(element.first) == element.second);
+            iterated++;
+        }
+        CHECK(iterated == snapshot.size());
+    }
+    stop.store(true);
+    writer.join();
+    CHECK(first.size() == 20000);
+    for (int key = 0; key < 20000; ++key)
+    {
+        CHECK(first.at(key) == key);
+    }
+    ConcurrentHashMap<int, long>::Snapshot last = map.snapshot();
+    size_t size = map.size();
+    map.clear();
+    CHECK(map.empty() && last.size() == size);
+    ConcurrentHashMap<int, long>::Snapshot empty = map.snapshot();
+    CHECK(empty.begin() == empty.end() && empty.empty());
+}
+
+int main()
+{
+    testRandomOperations();
+    testConcurrentWriters();
+    testSnapshots();
+    std::printf("ConcurrentHashMap tests passed\n");
+    return 0;
+}
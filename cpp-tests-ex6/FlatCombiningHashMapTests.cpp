@@ -0,0 +1,122 @@
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../FlatCombiningHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * the single key operations, compared with std::unordered_map.
+ */
+static void testRandomOperations()
+{
+    FlatCombiningHashMap<int, long> map;
+    std::unordered_map<int, long> expected;
+    std::mt19937 random(5);
+    for (int i = 0; i < 100000; ++i)
+    {
+        int key = (int) (random() % 500);
+        long value = (long) (random() % 1000);
+        switch (random() % 5)
+        {
+            case 0:
+                CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                break;
+            case 1:
+                CHECK(map.insert_or_assign(key, value) == (expected.count(key) == 0));
+                expected[key] = value;
+                break;
+            case 2:
+                map.update(key, [value](long& current)
+                {
+                    current += value;
+                });
+                expected[key] += value;
+                break;
+            case 3:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            default:
+            {
+                long found = 0;
+                bool contained = map.find(key, found);
+                CHECK(contained == (expected.count(key) == 1));
+                CHECK(!contained || found == expected[key]);
+                CHECK(map.contains_key(key) == contained);
+            }
+        }
+    }
+    CHECK(map.size() == expected.size());
+}
+
+/**
+ * skewed concurrent updates are all applied, and an update that throws reaches its caller.
+ */
+static void testConcurrentUpdates()
+{
+    FlatCombiningHashMap<int, long> map;
+    const int numOfThreads = 4;
+    const int perThread = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numOfThreads; ++t)
+    {
+        threads.emplace_back([&map, t]
+        {
+            std::mt19937 random(t);
+            for (int i = 0; i < perThread; ++i)
+            {
+                int key = random() % 100 < 80 ? (int) (random() % 4) : 100 + (int) (random() % 1000);
+                map.update(key, [](long& value)
+                {
+                    value++;
+                });
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    long total = 0;
+    for (int key = 0; key < 1100; ++key)
+    {
+        long value = 0;
+        if (map.find(key, value))
+        {
+            total += value;
+        }
+    }
+    CHECK(total == (long) numOfThreads * perThread);
+    bool thrown = false;
+    try
+    {
+        map.update(1, [](long&)
+        {
+            throw std::runtime_error("update failed");
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try
+    {
+        map.at(-5);
+    }
+    catch (const std::out_of_range&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main()
+{
+    testRandomOperations();
+    testConcurrentUpdates();
+    std::printf("FlatCombiningHashMap tests passed\n");
+    return 0;
+}
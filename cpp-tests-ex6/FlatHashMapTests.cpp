@@ -0,0 +1,162 @@
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "../FlatHashMap.hpp"
+#include "../GroupMatch.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * a hash with few distinct codes, so long probe sequences cross groups and erased slots are reused.
+ */
+struct PoorHash
+{
+    size_t operator()(int key) const
+    {
+        return (size_t) (key % 64);
+    }
+};
+
+/**
+ * random operations compared with std::unordered_map.
+ * @tparam Map - the map type.
+ * @param numOfKeys - keys are drawn from [0, numOfKeys).
+ * @param numOfOperations - number of operations.
+ */
+template<typename Map>
+static void checkRandomOperations(int numOfKeys, int numOfOperations)
+{
+    Map map;
+    std::unordered_map<int, long> expected;
+    std::mt19937 random(11);
+    for (int i = 0; i < numOfOperations; ++i)
+    {
+        int key = (int) (random() % numOfKeys);
+        long value = (long) random();
+        switch (random() % 4)
+        {
+            case 0:
+                CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                break;
+            case 1:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            case 2:
+                map[key] += value;
+                expected[key] += value;
+                break;
+            default:
+                CHECK(map.contains_key(key) == (expected.count(key) == 1));
+                CHECK(!map.contains_key(key) || map.at(key) == expected[key]);
+        }
+    }
+    CHECK(map.size() == expected.size());
+    CHECK(map.load_factor() <= 0.875);
+    size_t visited = 0;
+    for (const pair<int, long>& element : map)
+    {
+        CHECK(expected.at(element.first) == element.second);
+        visited++;
+    }
+    CHECK(visited == expected.size());
+    Map copy(map);
+    CHECK(copy == map);
+    copy.erase(expected.begin()->first);
+    CHECK(copy != map);
+    copy = map;
+    CHECK(copy == map);
+    map.clear();
+    CHECK(map.empty() && !map.contains_key(expected.begin()->first));
+    CHECK(copy.size() == expected.size());
+}
+
+/**
+ * the batched lookups must give what single lookups give, and at_many throws on a missing key.
+ */
+static void testBatchedLookups()
+{
+    std::vector<int> keys;
+    std::vector<long> values;
+    for (int key = 0; key < 5000; ++key)
+    {
+        keys.push_back(key * 2);
+        values.push_back(key * 7);
+    }
+    FlatHashMap<int, long> map(keys.begin(), keys.end(), values.begin(), values.end());
+    CHECK(map.size() == keys.size());
+    std::vector<int> queries;
+    for (int key = 0; key < 10000; ++key)
+    {
+        queries.push_back(key);
+    }
+    std::vector<bool> contained;
+    map.contains_many(queries.begin(), queries.end(), std::back_inserter(contained));
+    CHECK(contained.size() == queries.size());
+    for (int key = 0; key < 10000; ++key)
+    {
+        CHECK(contained[key] == (key % 2 == 0));
+    }
+    std::vector<long> found;
+    map.at_many(keys.begin(), keys.end(), std::back_inserter(found));
+    CHECK(found == values);
+    bool thrown = false;
+    try
+    {
+        map.at_many(queries.begin(), queries.end(), std::back_inserter(found));
+    }
+    catch (const std::out_of_range&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try
+    {
+        FlatHashMap<int, long> mismatched(keys.begin(), keys.end(), values.begin(), values.end() - 1);
+    }
+    catch (const std::length_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * the vector matches must agree with the scalar ones on groups of empty, deleted and full control bytes.
+ */
+static void testGroupMatch()
+{
+    std::mt19937 random(5);
+    signed char group[GroupMatch::kWidth];
+    for (int round = 0; round < 10000; ++round)
+    {
+        for (size_t i = 0; i < GroupMatch::kWidth; ++i)
+        {
+            switch (random() % 4)
+            {
+                case 0:
+                    group[i] = -128;
+                    break;
+                case 1:
+                    group[i] = -2;
+                    break;
+                default:
+                    group[i] = (signed char) (random() % 128);
+            }
+        }
+        signed char value = group[random() % GroupMatch::kWidth];
+        CHECK(GroupMatch::match(group, value) == GroupMatch::match_scalar(group, value));
+        CHECK(GroupMatch::match_negative(group) == GroupMatch::match_negative_scalar(group));
+    }
+}
+
+int main()
+{
+    checkRandomOperations<FlatHashMap<int, long>>(20000, 300000);
+    checkRandomOperations<FlatHashMap<int, long, PoorHash>>(2000, 50000);
+    testBatchedLookups();
+    testGroupMatch();
+    std::printf("FlatHashMap tests passed\n");
+    return 0;
+}
@@ -0,0 +1,1258 @@
+#include <atomic>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../HashMap.hpp"
+#include "../HashMix.hpp"
+#include "../PoolAllocator.hpp"
+#include "../ThreadPool.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * units of work done by the maps of a test: calls of CountingHash and elements or buckets constructed or destroyed
+ * by CountingAllocator.
+ */
+static size_t work = 0;
+
+/**
+ * std::hash that counts its calls in work.
+ */
+struct CountingHash
+{
+    size_t operator()(int key) const
+    {
+        work++;
+        return std::hash<int>()(key);
+    }
+};
+
+/**
+ * std::allocator that counts the objects it constructs and destroys in work.
+ */
+template<typename T>
+struct CountingAllocator: public std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        typedef CountingAllocator<U> other;
+    };
+
+    CountingAllocator() = default;
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&)
+    {
+
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        work++;
+        ::new ((void*) p) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U* p)
+    {
+        work++;
+        p->~U();
+    }
+};
+
+template<typename T, typename U>
+bool operator ==(const CountingAllocator<T>&, const CountingAllocator<U>&)
+{
+    return true;
+}
+
+template<typename T, typename U>
+bool operator !=(const CountingAllocator<T>&, const CountingAllocator<U>&)
+{
+    return false;
+}
+
+typedef HashMap<int, int, CountingHash, std::equal_to<int>, false, CountingAllocator<pair<int, int>>> CountingMap;
+
+/**
+ * a value that counts how many times values were constructed and assigned.
+ */
+struct Counted
+{
+    static int constructed;
+    static int assigned;
+    int value;
+
+    explicit Counted(int v = 0): value(v)
+    {
+        constructed++;
+    }
+
+    Counted(int a, int b): value(a * b)
+    {
+        constructed++;
+    }
+
+    Counted(const Counted& other): value(other.value)
+    {
+        constructed++;
+    }
+
+    Counted(Counted&& other): value(other.value)
+    {
+        constructed++;
+    }
+
+    Counted& operator =(const Counted& other)
+    {
+        assigned++;
+        value = other.value;
+        return *this;
+    }
+
+    Counted& operator =(Counted&& other)
+    {
+        assigned++;
+        value = other.value;
+        return *this;
+    }
+};
+
+int Counted::constructed = 0;
+int Counted::assigned = 0;
+
+/**
+ * a hash with a seed, to check that the maps keep the hash object they were given.
+ */
+struct SeededHash
+{
+    size_t seed;
+
+    size_t operator()(int key) const
+    {
+        return std::hash<int>()(key) ^ seed;
+    }
+};
+
+/**
+ * compares keys by their remainder modulo 1000.
+ */
+struct ModuloEqual
+{
+    bool operator()(int a, int b) const
+    {
+        return a % 1000 == b % 1000;
+    }
+};
+
+/**
+ * a hash with 8 distinct codes, so the buckets hold many elements each.
+ */
+struct EightHash
+{
+    size_t operator()(int key) const
+    {
+        return (size_t) (key & 7);
+    }
+};
+
+/**
+ * a hash with 4096 distinct codes, so large maps have buckets of many elements in the order they were inserted.
+ */
+struct FewHash
+{
+    size_t operator()(int key) const
+    {
+        return (size_t) (key & 4095);
+    }
+};
+
+/**
+ * check that a call throws std::out_of_range.
+ * @tparam Function - type of the call.
+ * @param function - the call.
+ * @return - true if it threw std::out_of_range.
+ */
+template<typename Function>
+static bool throwsOutOfRange(Function function)
+{
+    try
+    {
+        function();
+    }
+    catch (const std::out_of_range&)
+    {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * insert keys one by one and get the most work a single insertion did.
+ * @param bucketsPerStep - the incremental rehash step, 0 to rebuild the whole map on resize.
+ * @param numOfKeys - number of keys to insert.
+ * @return - the largest work of one insertion.
+ */
+static size_t maxInsertWork(size_t bucketsPerStep, int numOfKeys)
+{
+    CountingMap map;
+    map.set_incremental_rehash(bucketsPerStep);
+    size_t maxWork = 0;
+    for (int key = 0; key < numOfKeys; ++key)
+    {
+        size_t before = work;
+        map.insert(key, key);
+        maxWork = std::max(maxWork, work - before);
+    }
+    CHECK(map.size() == (size_t) numOfKeys);
+    for (int key = 0; key < numOfKeys; ++key)
+    {
+        CHECK(map.at(key) == key);
+    }
+    return maxWork;
+}
+
+/**
+ * with incremental rehash no insertion does work that grows with the map: the rehash always ends before the next
+ * resize, and the new buckets are constructed as the old ones are moved.
+ */
+static void testIncrementalRehashBound()
+{
+    const int numOfKeys = 1 << 20;
+    CHECK(maxInsertWork(0, numOfKeys) > (size_t) numOfKeys);
+    CHECK(maxInsertWork(1, numOfKeys) < 64);
+    CHECK(maxInsertWork(16, numOfKeys) < 256);
+}
+
+/**
+ * random operations with incremental rehash compared with std::unordered_map, also copying, iterating and clearing
+ * the map while a rehash is in progress.
+ */
+static void testRandomIncrementalOperations()
+{
+    HashMap<int, long> map;
+    map.set_incremental_rehash(1);
+    std::unordered_map<int, long> expected;
+    std::mt19937 random(17);
+    bool sawRehash = false;
+    for (int i = 0; i < 300000; ++i)
+    {
+        int key = (int) (random() % 20000);
+        long value = (long) random();
+        int range = i < 150000 ? 3 : 5;
+        switch (random() % range)
+        {
+            case 0:
+            case 3:
+                CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                break;
+            case 1:
+            case 4:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            default:
+                CHECK(map.contains_key(key) == (expected.count(key) == 1));
+                CHECK(!map.contains_key(key) || map.at(key) == expected[key]);
+        }
+        if (map.rehashing() && i % 1000 == 0)
+        {
+            sawRehash = true;
+            size_t visited = 0;
+            for (const pair<int, long>& element : map)
+            {
+                CHECK(expected.at(element.first) == element.second);
+                visited++;
+            }
+            CHECK(visited == expected.size());
+            HashMap<int, long> copy(map);
+            CHECK(copy == map);
+            HashMap<int, long> assigned;
+            assigned = map;
+            CHECK(assigned.size() == expected.size());
+        }
+    }
+    CHECK(sawRehash);
+    CHECK(map.size() == expected.size());
+    while (!map.rehashing())
+    {
+        map.insert((int) map.size() + 20000, 0);
+    }
+    map.clear();
+    CHECK(map.empty() && !map.rehashing() && map.begin() == map.end());
+    map.insert(1, 1);
+    CHECK(map.at(1) == 1);
+}
+
+/**
+ * bucket_index and bucket_size must name the same bucket, also for keys not yet moved by an incremental rehash.
+ */
+static void testBucketIndexWhileRehashing()
+{
+    HashMap<int, int> map;
+    map.set_incremental_rehash(1);
+    int key = 0;
+    while (!map.rehashing())
+    {
+        map.insert(key, key);
+        key++;
+    }
+    bool inOldBuckets = false;
+    std::map<size_t, size_t> counts;
+    for (int k = 0; k < key; ++k)
+    {
+        size_t index = map.bucket_index(k);
+        inOldBuckets = inOldBuckets || index >= map.capacity();
+        counts[index]++;
+    }
+    CHECK(inOldBuckets);
+    for (int k = 0; k < key; ++k)
+    {
+        CHECK(counts[map.bucket_index(k)] == map.bucket_size(k));
+    }
+}
+
+/**
+ * erase must not shrink the table below the capacity set by reserve, until shrink_to_fit drops that floor.
+ */
+static void testReserveFloor()
+{
+    HashMap<int, int> map;
+    map.reserve(1000);
+    size_t reserved = map.capacity();
+    for (int k = 0; k < 1000; ++k)
+    {
+        map.insert(k, k);
+    }
+    for (int k = 0; k < 999; ++k)
+    {
+        map.erase(k);
+    }
+    CHECK(map.capacity() == reserved);
+    map.insert(0, 0);
+    map.erase_if([](const std::pair<int, int>& element)
+    {
+        return element.first == 0;
+    });
+    CHECK(map.capacity() == reserved);
+    HashMap<int, int> copy(map);
+    copy.erase(999);
+    CHECK(copy.capacity() == reserved);
+    map.shrink_to_fit();
+    CHECK(map.capacity() < reserved);
+    map.erase(999);
+    CHECK(map.capacity() == 1);
+}
+
+/**
+ * find returns an iterator to the element or end(), and find, at, operator[], contains_key and erase hash the key
+ * once, on a hit and on a miss.
+ */
+static void testSingleProbeAccessors()
+{
+    HashMap<int, int, CountingHash> map;
+    map.reserve(2000);
+    for (int key = 0; key < 1000; ++key)
+    {
+        map.insert(key, key * 3);
+    }
+    const HashMap<int, int, CountingHash>& constMap = map;
+    for (int key = 0; key < 2000; ++key)
+    {
+        bool present = key < 1000;
+        size_t before = work;
+        HashMap<int, int, CountingHash>::iterator it = map.find(key);
+        CHECK(work - before == 1);
+        CHECK((it != map.end()) == present);
+        CHECK(!present || (it->first == key && it->second == key * 3));
+        CHECK((constMap.find(key) == it));
+        before = work;
+        CHECK(map.contains_key(key) == present);
+        CHECK(work - before == 1);
+        before = work;
+        CHECK(throwsOutOfRange([&map, key] { map.at(key); }) == !present);
+        CHECK(throwsOutOfRange([&constMap, key] { constMap.at(key); }) == !present);
+        CHECK(work - before == 2);
+    }
+    size_t before = work;
+    map.at(5) = 50;
+    map[6] = 60;
+    map[5000] += 7;
+    CHECK(work - before == 3);
+    CHECK(constMap.at(5) == 50 && constMap[6] == 60 && constMap[5000] == 7 && map.size() == 1001);
+    CHECK(constMap[-1] == 0 && map.size() == 1001);
+    before = work;
+    CHECK(map.erase(5000) && !map.erase(5000) && map.erase(0));
+    CHECK(work - before == 3);
+    CHECK(map.find(0) == map.end() && map.size() == 999);
+    size_t visited = 0;
+    for (HashMap<int, int, CountingHash>::iterator it = map.begin(); it != map.end(); ++it)
+    {
+        CHECK(map.find(it->first) == it);
+        visited++;
+    }
+    CHECK(visited == map.size());
+}
+
+/**
+ * try_emplace constructs nothing and leaves the key alone on a hit, emplace builds the element before the lookup,
+ * and insert_or_assign assigns on a hit and inserts on a miss.
+ */
+static void testEmplace()
+{
+    HashMap<std::string, Counted> map;
+    map.reserve(100);
+    CHECK(map.try_emplace(std::string("a"), 3, 4));
+    CHECK(map.at("a").value == 12 && Counted::constructed == 1);
+    std::string key("a");
+    CHECK(!map.try_emplace(std::move(key), 5, 6));
+    CHECK(!map.try_emplace("a", 7));
+    CHECK(key == "a" && map.at("a").value == 12 && Counted::constructed == 1);
+    CHECK(map.try_emplace(key + "b", 2));
+    CHECK(map.at("ab").value == 2 && Counted::constructed == 2);
+    int before = Counted::constructed;
+    CHECK(!map.emplace(std::piecewise_construct, std::forward_as_tuple("a"), std::forward_as_tuple(9)));
+    CHECK(Counted::constructed > before && map.at("a").value == 12);
+    CHECK(map.emplace(std::make_pair(std::string("c"), Counted(8))));
+    CHECK(map.at("c").value == 8 && map.size() == 3);
+    before = Counted::constructed;
+    CHECK(!map.insert_or_assign("c", Counted(10)));
+    CHECK(map.at("c").value == 10 && Counted::constructed == before + 1 && Counted::assigned == 1);
+    std::string moved("d");
+    CHECK(map.insert_or_assign(std::move(moved), Counted(11)));
+    CHECK(map.at("d").value == 11 && Counted::assigned == 1 && map.size() == 4);
+    CHECK(!map.insert_or_assign(std::string("d"), Counted(12)) && map.at("d").value == 12);
+}
+
+/**
+ * get the size of the largest bucket of a map.
+ * @tparam Map - the map type.
+ * @param map - the map.
+ * @return - the largest bucket size.
+ */
+template<typename Map>
+static size_t largestBucket(const Map& map)
+{
+    size_t largest = 0;
+    for (const pair<int, int>& element : map)
+    {
+        largest = std::max(largest, map.bucket_size(element.first));
+    }
+    return largest;
+}
+
+/**
+ * MixedHash spreads keys that differ only in their high bits, which the identity std::hash of int puts in a few
+ * buckets, and the maps use the hash and key equality objects they were constructed with.
+ */
+static void testMixedHash()
+{
+    CHECK(mix_hash(0) == 0 && mix_hash(1) != 1 && mix_hash(64) != mix_hash(128));
+    CHECK(MixedHash<std::hash<int>>()(42) == mix_hash(std::hash<int>()(42)));
+    HashMap<int, int> raw;
+    HashMap<int, int, MixedHash<std::hash<int>>> mixed;
+    for (int i = 0; i < 10000; ++i)
+    {
+        raw.insert(i * 64, i);
+        mixed.insert(i * 64, i);
+    }
+    CHECK(raw.capacity() == mixed.capacity());
+    CHECK(largestBucket(raw) >= 32);
+    CHECK(largestBucket(mixed) <= 10);
+    for (int i = 0; i < 10000; ++i)
+    {
+        CHECK(mixed.at(i * 64) == i && !mixed.contains_key(i * 64 + 1));
+    }
+    MixedHash<SeededHash> seeded(SeededHash{12345});
+    CHECK(seeded(7) == mix_hash(7 ^ 12345));
+    HashMap<int, int, MixedHash<SeededHash>> seededMap(seeded);
+    seededMap.insert(7, 1);
+    HashMap<int, int, MixedHash<SeededHash>> seededCopy(seededMap);
+    CHECK(seededCopy.at(7) == 1 && seededCopy == seededMap);
+    HashMap<int, int, std::function<size_t(int)>, ModuloEqual> modulo([](int key)
+    {
+        return (size_t) (key % 1000);
+    }, ModuloEqual());
+    CHECK(modulo.insert(5, 1) && !modulo.insert(1005, 2) && modulo.at(2005) == 1);
+    CHECK(modulo.erase(3005) && modulo.empty());
+}
+
+/**
+ * with StoreHash every key is hashed once when it is inserted, and growing, shrinking, rehashing, copying and
+ * comparing the map reuse the stored hash codes, with or without incremental rehash.
+ */
+static void testStoredHash()
+{
+    for (size_t step = 0; step <= 1; ++step)
+    {
+        HashMap<int, int, CountingHash, std::equal_to<int>, true> map;
+        map.set_incremental_rehash(step);
+        size_t before = work;
+        for (int key = 0; key < 10000; ++key)
+        {
+            map.insert(key, key);
+        }
+        CHECK(work - before == 10000 && map.capacity() > 10000);
+        before = work;
+        map.rehash(map.capacity() * 4);
+        map.reserve(200000);
+        HashMap<int, int, CountingHash, std::equal_to<int>, true> copy(map);
+        CHECK(copy == map);
+        copy.shrink_to_fit();
+        CHECK(work == before && copy.capacity() < map.capacity());
+        for (int key = 0; key < 9990; ++key)
+        {
+            copy.erase(key);
+        }
+        CHECK(work - before == 9990 && copy.capacity() <= 64);
+        for (int key = 9990; key < 10000; ++key)
+        {
+            CHECK(copy.at(key) == key && map.at(key) == key);
+        }
+    }
+    HashMap<int, int, CountingHash> unstored;
+    size_t before = work;
+    for (int key = 0; key < 10000; ++key)
+    {
+        unstored.insert(key, key);
+    }
+    CHECK(work - before > 20000);
+}
+
+/**
+ * check that a map holds exactly the keys in [begin, end), each mapped to its double.
+ * @tparam Map - the map type.
+ * @param map - the map.
+ * @param begin - the first key.
+ * @param end - past the last key.
+ */
+template<typename Map>
+static void checkRange(const Map& map, int begin, int end)
+{
+    CHECK(map.size() == (size_t) (end - begin));
+    size_t visited = 0;
+    for (const pair<int, int>& element : map)
+    {
+        CHECK(element.first >= begin && element.first < end && element.second == element.first * 2);
+        visited++;
+    }
+    CHECK(visited == map.size());
+    for (int key = begin; key < end; ++key)
+    {
+        CHECK(map.at(key) == key * 2);
+    }
+}
+
+/**
+ * grow, shrink, copy, move, swap and clear a map.
+ * @tparam Map - the map type.
+ */
+template<typename Map>
+static void checkContainerOperations()
+{
+    Map map;
+    for (int key = 0; key < 20000; ++key)
+    {
+        CHECK(map.insert(key, key * 2));
+    }
+    checkRange(map, 0, 20000);
+    size_t grown = map.capacity();
+    for (int key = 0; key < 19000; ++key)
+    {
+        CHECK(map.erase(key));
+    }
+    CHECK(map.capacity() < grown);
+    checkRange(map, 19000, 20000);
+    Map copy(map);
+    CHECK(copy == map);
+    checkRange(copy, 19000, 20000);
+    Map assigned;
+    assigned.insert(-1, -2);
+    assigned = copy;
+    CHECK(assigned == map);
+    Map moved(std::move(copy));
+    CHECK(moved == map && copy.empty());
+    copy.insert(1, 2);
+    checkRange(copy, 1, 2);
+    Map moveAssigned;
+    moveAssigned = std::move(moved);
+    checkRange(moveAssigned, 19000, 20000);
+    std::swap(copy, moveAssigned);
+    checkRange(copy, 19000, 20000);
+    checkRange(moveAssigned, 1, 2);
+    map.clear();
+    CHECK(map.empty() && map.begin() == map.end() && !map.contains_key(19000));
+    for (int key = 0; key < 100; ++key)
+    {
+        map.insert(key, key * 2);
+    }
+    checkRange(map, 0, 100);
+    checkRange(assigned, 19000, 20000);
+}
+
+/**
+ * PoolResource hands freed blocks out again, and a map with a PoolAllocator keeps its resource when it is moved,
+ * while a copy gets a resource of its own.
+ */
+static void testPoolAllocator()
+{
+    checkContainerOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, false,
+                                     PoolAllocator<pair<int, int>>>>();
+    checkContainerOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, true,
+                                     PoolAllocator<pair<int, int>>>>();
+    PoolResource resource;
+    void* small = resource.allocate(24);
+    void* other = resource.allocate(24);
+    CHECK(small != other);
+    resource.deallocate(small, 24);
+    CHECK(resource.allocate(20) == small);
+    void* large = resource.allocate(1 << 20);
+    resource.deallocate(large, 1 << 20);
+    typedef PoolAllocator<pair<int, int>> Allocator;
+    typedef HashMap<int, int, std::hash<int>, std::equal_to<int>, false, Allocator> PoolMap;
+    std::shared_ptr<PoolResource> shared = std::make_shared<PoolResource>();
+    PoolMap map{Allocator(shared)};
+    for (int key = 0; key < 1000; ++key)
+    {
+        map.insert(key, key * 2);
+    }
+    CHECK(map.get_allocator().resource() == shared);
+    PoolMap copy(map);
+    CHECK(copy.get_allocator().resource() != shared && copy == map);
+    PoolMap moved(std::move(map));
+    CHECK(moved.get_allocator().resource() == shared);
+    checkRange(moved, 0, 1000);
+    copy = moved;
+    CHECK(copy.get_allocator().resource() != shared);
+    checkRange(copy, 0, 1000);
+}
+
+/**
+ * random operations on a map whose buckets spill out of their inline storage, compared with std::unordered_map,
+ * copying, swapping and moving the map on the way.
+ * @tparam Map - the map type.
+ */
+template<typename Map>
+static void checkSpilledBuckets()
+{
+    Map map;
+    std::unordered_map<int, int> expected;
+    std::mt19937 random(23);
+    for (int i = 0; i < 20000; ++i)
+    {
+        int key = (int) (random() % 400);
+        if (random() % 3 == 0)
+        {
+            CHECK(map.erase(key) == (expected.erase(key) == 1));
+        }
+        else
+        {
+            CHECK(map.insert(key, key * 2) == expected.emplace(key, key * 2).second);
+        }
+        if (i % 2000 == 0)
+        {
+            Map copy(map);
+            Map other;
+            other.insert(-1, -2);
+            std::swap(copy, other);
+            CHECK(other == map && copy.size() == 1 && copy.at(-1) == -2);
+            map = std::move(other);
+        }
+    }
+    CHECK(map.size() == expected.size());
+    for (const std::pair<const int, int>& element : expected)
+    {
+        CHECK(map.at(element.first) == element.second);
+        CHECK(map.bucket_size(element.first) > 2);
+    }
+    map.clear();
+    CHECK(map.empty() && map.begin() == map.end());
+    map.insert(3, 6);
+    checkRange(map, 3, 4);
+}
+
+/**
+ * buckets that keep one or two elements inline: growth, shrink, copy, move, swap and clear, and buckets that spill
+ * to the heap and back.
+ */
+static void testInlineBuckets()
+{
+    checkContainerOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, false,
+                                     std::allocator<pair<int, int>>, 1>>();
+    checkContainerOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, false,
+                                     std::allocator<pair<int, int>>, 2>>();
+    checkContainerOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, true,
+                                     std::allocator<pair<int, int>>, 2>>();
+    checkContainerOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, true,
+                                     PoolAllocator<pair<int, int>>, 1>>();
+    checkSpilledBuckets<HashMap<int, int, EightHash, std::equal_to<int>, false, std::allocator<pair<int, int>>, 1>>();
+    checkSpilledBuckets<HashMap<int, int, EightHash, std::equal_to<int>, true, std::allocator<pair<int, int>>, 2>>();
+    checkSpilledBuckets<HashMap<int, int, EightHash, std::equal_to<int>, false, PoolAllocator<pair<int, int>>, 2>>();
+    HashMap<int, int, EightHash, std::equal_to<int>, false, std::allocator<pair<int, int>>, 2> map;
+    map.insert(0, 0);
+    map.insert(8, 16);
+    CHECK(map.bucket_size(0) == 2);
+    map.insert(16, 32);
+    CHECK(map.bucket_size(0) == 3 && map.at(0) == 0 && map.at(8) == 16 && map.at(16) == 32);
+    map.erase(8);
+    map.erase(16);
+    CHECK(map.bucket_size(0) == 1 && map.at(0) == 0);
+    map.insert(24, 48);
+    map.insert(32, 64);
+    CHECK(map.bucket_size(0) == 3 && map.at(24) == 48 && map.at(32) == 64 && !map.contains_key(8));
+}
+
+/**
+ * grow, shrink, rehash, copy and assign a map large enough that its buckets are split between the threads of a
+ * pool.
+ * @tparam Map - the map type.
+ * @param pool - the pool.
+ */
+template<typename Map>
+static void checkPooledResize(ThreadPool& pool)
+{
+    Map map;
+    map.set_thread_pool(&pool);
+    for (int key = 0; key < 200000; ++key)
+    {
+        map.insert(key, key * 2);
+    }
+    CHECK(map.capacity() >= 1 << 18);
+    checkRange(map, 0, 200000);
+    Map copy(map);
+    CHECK(copy == map);
+    checkRange(copy, 0, 200000);
+    Map assigned;
+    assigned = map;
+    CHECK(assigned.equals(map, &pool));
+    map.rehash(map.capacity() * 2);
+    checkRange(map, 0, 200000);
+    for (int key = 0; key < 190000; ++key)
+    {
+        map.erase(key);
+    }
+    CHECK(map.capacity() < 1 << 16);
+    checkRange(map, 190000, 200000);
+    copy.reserve(400000);
+    checkRange(copy, 0, 200000);
+    copy.shrink_to_fit();
+    CHECK(copy.capacity() == assigned.capacity() && copy == assigned);
+}
+
+/**
+ * resizes and copies split between the threads of a pool give the same maps as on one thread.
+ */
+static void testPooledResize()
+{
+    ThreadPool pool(3);
+    checkPooledResize<HashMap<int, int>>(pool);
+    checkPooledResize<HashMap<int, int, std::hash<int>, std::equal_to<int>, true>>(pool);
+    checkPooledResize<HashMap<int, int, std::hash<int>, std::equal_to<int>, false,
+                              std::allocator<pair<int, int>>, 1>>(pool);
+}
+
+/**
+ * build a map from ranges of keys and values with a pool, on one thread and from ranges that can only be walked,
+ * where every key below 40000 appears twice and gets its later value.
+ * @tparam Map - the map type.
+ * @param pool - the pool.
+ */
+template<typename Map>
+static void checkRangeConstructor(ThreadPool& pool)
+{
+    std::vector<int> keys;
+    std::vector<int> values;
+    for (int i = 0; i < 100000; ++i)
+    {
+        keys.push_back(i % 60000);
+        values.push_back(i);
+    }
+    Map parallel(keys.begin(), keys.end(), values.begin(), values.end(), &pool);
+    Map serial(keys.begin(), keys.end(), values.begin(), values.end());
+    std::list<int> keyList(keys.begin(), keys.end());
+    Map walked(keyList.begin(), keyList.end(), values.begin(), values.end(), &pool);
+    CHECK(parallel.size() == 60000 && parallel == serial && walked.size() == 60000);
+    for (int key = 0; key < 60000; ++key)
+    {
+        int last = key < 40000 ? key + 60000 : key;
+        CHECK(parallel.at(key) == last && walked.at(key) == last);
+    }
+    parallel.insert(-1, -1);
+    for (int key = 0; key < 50000; ++key)
+    {
+        parallel.erase(key);
+    }
+    CHECK(parallel.size() == 10001 && parallel.at(-1) == -1 && parallel.at(59999) == 59999);
+    bool thrown = false;
+    try
+    {
+        Map invalid(keys.begin(), keys.end(), values.begin(), values.end() - 1, &pool);
+    }
+    catch (const std::length_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * the range constructor scatters the pairs between the threads of a pool, keeping the last value of every key.
+ */
+static void testParallelRangeConstructor()
+{
+    ThreadPool pool(3);
+    checkRangeConstructor<HashMap<int, int>>(pool);
+    checkRangeConstructor<HashMap<int, int, std::hash<int>, std::equal_to<int>, true>>(pool);
+    checkRangeConstructor<HashMap<int, int, MixedHash<std::hash<int>>>>(pool);
+    checkRangeConstructor<HashMap<int, int, std::hash<int>, std::equal_to<int>, false,
+                                  std::allocator<pair<int, int>>, 2>>(pool);
+}
+
+/**
+ * clone and equals split between the threads of a pool agree with the copy constructor and operator==, also for
+ * buckets that hold the same elements in another order and for maps in the middle of an incremental rehash.
+ * @tparam Map - the map type.
+ * @param pool - the pool.
+ */
+template<typename Map>
+static void checkCloneAndEquals(ThreadPool& pool)
+{
+    Map map;
+    Map reversed;
+    map.reserve(100000);
+    reversed.reserve(100000);
+    for (int key = 0; key < 100000; ++key)
+    {
+        map.insert(key, key * 2);
+        reversed.insert(99999 - key, (99999 - key) * 2);
+    }
+    CHECK(map.capacity() >= 1 << 17 && map.capacity() == reversed.capacity());
+    CHECK(map.equals(reversed, &pool) && map.equals(reversed, nullptr) && map == reversed);
+    Map cloned = map.clone(&pool);
+    CHECK(cloned.capacity() == map.capacity() && cloned.equals(map, &pool));
+    checkRange(cloned, 0, 100000);
+    Map serial = map.clone(nullptr);
+    CHECK(serial.equals(cloned, &pool));
+    cloned.at(77777) = 0;
+    CHECK(!cloned.equals(map, &pool) && !cloned.equals(map, nullptr) && cloned != map);
+    cloned.erase(77777);
+    cloned.insert(100000, 200000);
+    CHECK(cloned.size() == map.size() && !cloned.equals(map, &pool));
+    cloned.erase(100000);
+    CHECK(!cloned.equals(map, &pool));
+    serial.rehash(serial.capacity() * 2);
+    CHECK(!serial.equals(map, &pool));
+    Map incremental;
+    incremental.set_incremental_rehash(1);
+    int key = 0;
+    while (key < 20000 || !incremental.rehashing())
+    {
+        incremental.insert(key, key * 2);
+        key++;
+    }
+    Map incrementalClone = incremental.clone(&pool);
+    CHECK(incrementalClone.equals(incremental, &pool) && incremental.equals(incrementalClone, &pool));
+    checkRange(incrementalClone, 0, key);
+    incrementalClone.at(0) = 1;
+    CHECK(!incremental.equals(incrementalClone, &pool));
+}
+
+/**
+ * clone and equals with a pool.
+ */
+static void testPooledCloneAndEquals()
+{
+    ThreadPool pool(3);
+    checkCloneAndEquals<HashMap<int, int, FewHash>>(pool);
+    checkCloneAndEquals<HashMap<int, int, FewHash, std::equal_to<int>, true>>(pool);
+    checkCloneAndEquals<HashMap<int, int, FewHash, std::equal_to<int>, true, std::allocator<pair<int, int>>, 2>>(pool);
+}
+
+/**
+ * find_many, contains_many and at_many agree with find for batches that do not fill their last group of prefetched
+ * keys, while an incremental rehash is in progress, and for keys given by a list. at_many writes the values of the
+ * keys before a missing one and then throws.
+ */
+static void testBatchedLookups()
+{
+    HashMap<int, int> map;
+    map.set_incremental_rehash(1);
+    int numOfKeys = 0;
+    while (numOfKeys < 1000 || !map.rehashing())
+    {
+        map.insert(numOfKeys * 2, numOfKeys * 4);
+        numOfKeys++;
+    }
+    std::list<int> keys;
+    for (int key = -5; key < numOfKeys * 2 + 5; ++key)
+    {
+        keys.push_back(key);
+    }
+    std::vector<HashMap<int, int>::iterator> found;
+    std::vector<bool> contained;
+    map.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+    map.contains_many(keys.begin(), keys.end(), std::back_inserter(contained));
+    CHECK(found.size() == keys.size() && contained.size() == keys.size());
+    size_t i = 0;
+    for (int key : keys)
+    {
+        CHECK(found[i] == map.find(key) && contained[i] == map.contains_key(key));
+        CHECK(contained[i] == (key >= 0 && key < numOfKeys * 2 && key % 2 == 0));
+        CHECK(!contained[i] || found[i]->second == key * 2);
+        i++;
+    }
+    std::vector<int> present;
+    for (int key = 0; key < 37; ++key)
+    {
+        present.push_back(key * 2);
+    }
+    std::vector<int> values;
+    map.at_many(present.begin(), present.end(), std::back_inserter(values));
+    CHECK(values.size() == 37);
+    for (int key = 0; key < 37; ++key)
+    {
+        CHECK(values[key] == key * 4);
+    }
+    present[20] = 1;
+    values.clear();
+    CHECK(throwsOutOfRange([&map, &present, &values]
+    {
+        map.at_many(present.begin(), present.end(), std::back_inserter(values));
+    }));
+    CHECK(values.size() == 20 && values[19] == 19 * 4);
+    values.clear();
+    map.at_many(present.begin(), present.begin(), std::back_inserter(values));
+    map.find_many(present.begin(), present.begin(), std::back_inserter(found));
+    CHECK(values.empty() && found.size() == keys.size());
+}
+
+/**
+ * extract moves an element out into a node, and insert(node_type&&) takes it only if its key is new, leaving the
+ * node untouched otherwise. neither hashes the key again.
+ */
+static void testNodes()
+{
+    typedef HashMap<int, std::unique_ptr<int>, CountingHash> NodeMap;
+    NodeMap map;
+    NodeMap other;
+    for (int key = 0; key < 100; ++key)
+    {
+        map.try_emplace(key, new int(key * 2));
+    }
+    other.try_emplace(5, new int(-5));
+    NodeMap::node_type missing = map.extract(1000);
+    CHECK(missing.empty() && !missing && map.size() == 100);
+    CHECK(!other.insert(std::move(missing)) && other.size() == 1);
+    NodeMap::node_type node = map.extract(7);
+    CHECK(!node.empty() && node && node.key() == 7 && *node.mapped() == 14);
+    CHECK(map.size() == 99 && !map.contains_key(7));
+    int* pointer = node.mapped().get();
+    size_t before = work;
+    CHECK(other.insert(std::move(node)));
+    CHECK(work == before && node.empty() && other.at(7).get() == pointer);
+    node = map.extract(5);
+    CHECK(!other.insert(std::move(node)));
+    CHECK(!node.empty() && node.key() == 5 && *node.mapped() == 10 && *other.at(5) == -5 && other.size() == 2);
+    CHECK(map.insert(std::move(node)) && *map.at(5) == 10 && map.size() == 99);
+}
+
+/**
+ * check the maps after merging keys [0, 300) with values of twice the key into a map that held the odd keys with
+ * their negation: the odd keys stay in source, the even ones moved. other keys of source must not be below 300.
+ * @tparam Map - the map type.
+ * @param target - the map merged into.
+ * @param source - the map merged from.
+ */
+template<typename Map>
+static void checkMerged(const Map& target, const Map& source)
+{
+    CHECK(source.size() == 150);
+    for (int key = 0; key < 300; ++key)
+    {
+        CHECK(target.at(key) == (key % 2 == 0 ? key * 2 : -key));
+        CHECK(source.contains_key(key) == (key % 2 == 1));
+        CHECK(key % 2 == 0 || source.at(key) == key * 2);
+    }
+}
+
+/**
+ * merge moves the elements whose key is new and leaves the others in source, also when either map is in the middle
+ * of an incremental rehash.
+ * @tparam Map - the map type.
+ */
+template<typename Map>
+static void checkMerge()
+{
+    for (int rehashing = 0; rehashing < 4; ++rehashing)
+    {
+        Map target;
+        Map source;
+        for (int key = 1; key < 300; key += 2)
+        {
+            target.insert(key, -key);
+        }
+        for (int key = 0; key < 300; ++key)
+        {
+            source.insert(key, key * 2);
+        }
+        target.set_incremental_rehash(1);
+        source.set_incremental_rehash(1);
+        int targetExtra = 1000;
+        while ((rehashing & 1) != 0 && !target.rehashing())
+        {
+            target.insert(targetExtra++, 0);
+        }
+        int sourceExtra = 100000;
+        while ((rehashing & 2) != 0 && !source.rehashing())
+        {
+            source.insert(sourceExtra++, 0);
+        }
+        size_t extras = (size_t) (targetExtra - 1000 + sourceExtra - 100000);
+        CHECK(target.rehashing() == ((rehashing & 1) != 0) && source.rehashing() == ((rehashing & 2) != 0));
+        target.merge(source);
+        CHECK(target.size() == 300 + extras);
+        checkMerged(target, source);
+        target.merge(target);
+        CHECK(target.size() == 300 + extras);
+    }
+}
+
+/**
+ * merge with and without stored hash codes, and with stored codes it hashes no key.
+ */
+static void testMerge()
+{
+    checkMerge<HashMap<int, int>>();
+    checkMerge<HashMap<int, int, std::hash<int>, std::equal_to<int>, true>>();
+    checkMerge<HashMap<int, int, std::hash<int>, std::equal_to<int>, false, std::allocator<pair<int, int>>, 1>>();
+    HashMap<int, int, CountingHash, std::equal_to<int>, true> target;
+    HashMap<int, int, CountingHash, std::equal_to<int>, true> source;
+    for (int key = 0; key < 300; ++key)
+    {
+        source.insert(key, key * 2);
+        if (key % 2 == 1)
+        {
+            target.insert(key, -key);
+        }
+    }
+    size_t before = work;
+    target.merge(source);
+    CHECK(work == before && target.size() == 300);
+    checkMerged(target, source);
+}
+
+/**
+ * erase_if and retain return the number of removed elements, split the buckets between the threads of a pool, and
+ * shrink the map once to the capacity that erasing the elements one by one would leave, so every kept key is
+ * rehashed at most once.
+ */
+static void testEraseIf()
+{
+    ThreadPool pool(3);
+    for (int pooled = 0; pooled < 2; ++pooled)
+    {
+        ThreadPool* threads = pooled == 1 ? &pool : nullptr;
+        HashMap<int, int, CountingHash> map;
+        HashMap<int, int, CountingHash> oneByOne;
+        for (int key = 0; key < 100000; ++key)
+        {
+            map.insert(key, key * 2);
+            oneByOne.insert(key, key * 2);
+        }
+        CHECK(map.capacity() >= 1 << 17);
+        for (int key = 0; key < 100000; ++key)
+        {
+            if (key % 100 != 0)
+            {
+                oneByOne.erase(key);
+            }
+        }
+        size_t before = work;
+        CHECK(map.erase_if([](const pair<int, int>& element)
+        {
+            return element.first % 100 != 0;
+        }, threads) == 99000);
+        CHECK(work - before == 1000);
+        CHECK(map.capacity() == oneByOne.capacity() && map == oneByOne);
+        before = work;
+        size_t capacity = map.capacity();
+        CHECK(map.retain([](const pair<int, int>& element)
+        {
+            return element.first % 200 == 0;
+        }, threads) == 500);
+        CHECK(work - before <= 500 && map.capacity() < capacity);
+        CHECK(map.size() == 500 && map.at(400) == 800 && !map.contains_key(100));
+        CHECK(map.erase_if([](const pair<int, int>&)
+        {
+            return false;
+        }, threads) == 0);
+        CHECK(map.retain([](const pair<int, int>&)
+        {
+            return false;
+        }, threads) == 500);
+        CHECK(map.empty() && map.begin() == map.end());
+    }
+    HashMap<int, int> incremental;
+    incremental.set_incremental_rehash(1);
+    int numOfKeys = 0;
+    while (numOfKeys < 1000 || !incremental.rehashing())
+    {
+        incremental.insert(numOfKeys, numOfKeys * 2);
+        numOfKeys++;
+    }
+    CHECK(incremental.erase_if([](const pair<int, int>& element)
+    {
+        return element.first % 2 == 1;
+    }, &pool) == (size_t) numOfKeys / 2);
+    CHECK(incremental.size() == (size_t) (numOfKeys + 1) / 2);
+    for (int key = 0; key < numOfKeys; ++key)
+    {
+        CHECK(incremental.contains_key(key) == (key % 2 == 0));
+    }
+}
+
+/**
+ * intersect, difference and union_with of a map of the keys [0, 60000) mapped to twice the key, and a map of the
+ * multiples of 3 below 90000 mapped to their negation, compared with std::unordered_map.
+ * @tparam Map - the map type.
+ * @param pool - the pool, or nullptr.
+ * @param layout - 0 for maps of the same capacity, 1 when other has fewer buckets, 2 when it has more, 3 when it
+ * is in the middle of an incremental rehash.
+ */
+template<typename Map>
+static void checkSetOperations(ThreadPool* pool, int layout)
+{
+    Map map;
+    Map other;
+    map.reserve(100000);
+    other.reserve(layout == 0 ? 100000 : layout == 2 ? 400000 : 0);
+    for (int key = 0; key < 60000; ++key)
+    {
+        map.insert(key, key * 2);
+    }
+    for (int key = 0; key < 90000; key += 3)
+    {
+        other.insert(key, -key);
+    }
+    if (layout == 3)
+    {
+        other.set_incremental_rehash(1);
+        for (int key = -1; !other.rehashing(); --key)
+        {
+            other.insert(key, -key);
+        }
+    }
+    CHECK(layout != 0 || map.capacity() == other.capacity());
+    CHECK(layout != 1 || map.capacity() > other.capacity());
+    CHECK(layout != 2 || map.capacity() < other.capacity());
+    CHECK(other.rehashing() == (layout == 3));
+    std::unordered_map<int, int> common;
+    std::unordered_map<int, int> rest;
+    std::unordered_map<int, int> united;
+    for (const pair<int, int>& element : map)
+    {
+        (other.contains_key(element.first) ? common : rest).insert(element);
+        united.insert(element);
+    }
+    for (const pair<int, int>& element : other)
+    {
+        if (map.contains_key(element.first))
+        {
+            united[element.first] += element.second;
+        }
+        else
+        {
+            united.insert(element);
+        }
+    }
+    Map intersection = map.intersect(other, pool);
+    Map difference = map.difference(other, pool);
+    CHECK(intersection.size() == common.size() && difference.size() == rest.size());
+    for (const std::pair<const int, int>& element : common)
+    {
+        CHECK(intersection.at(element.first) == element.second);
+    }
+    for (const std::pair<const int, int>& element : rest)
+    {
+        CHECK(difference.at(element.first) == element.second);
+    }
+    CHECK(intersection.load_factor() >= intersection.lower_threshold());
+    std::atomic<size_t> calls(0);
+    std::atomic<bool> wrong(false);
+    map.union_with(other, [&calls, &wrong](int& mine, const int& theirs)
+    {
+        calls++;
+        if (mine != -2 * theirs)
+        {
+            wrong.store(true);
+        }
+        mine += theirs;
+    }, pool);
+    CHECK(calls.load() == common.size() && !wrong.load());
+    CHECK(map.size() == united.size() && !map.rehashing());
+    for (const std::pair<const int, int>& element : united)
+    {
+        CHECK(map.at(element.first) == element.second);
+    }
+}
+
+/**
+ * intersect, difference and union_with on the aligned path and on the lookups of other, with and without a pool
+ * and stored hash codes, and union_with of a map with itself.
+ */
+static void testSetOperations()
+{
+    ThreadPool pool(3);
+    for (int layout = 0; layout < 4; ++layout)
+    {
+        checkSetOperations<HashMap<int, int>>(nullptr, layout);
+        checkSetOperations<HashMap<int, int>>(&pool, layout);
+        checkSetOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, true>>(nullptr, layout);
+        checkSetOperations<HashMap<int, int, std::hash<int>, std::equal_to<int>, true>>(&pool, layout);
+    }
+    checkSetOperations<HashMap<int, int, MixedHash<std::hash<int>>, std::equal_to<int>, false,
+                                std::allocator<pair<int, int>>, 1>>(&pool, 1);
+    HashMap<int, int> map;
+    for (int key = 0; key < 1000; ++key)
+    {
+        map.insert(key, key);
+    }
+    size_t calls = 0;
+    map.union_with(map, [&calls](int& mine, const int& theirs)
+    {
+        calls++;
+        mine += theirs;
+    });
+    CHECK(calls == 1000 && map.size() == 1000 && map.at(999) == 1998);
+    CHECK(map.intersect(map).size() == 1000 && map.difference(map).empty());
+}
+
+int main()
+{
+    testSingleProbeAccessors();
+    testEmplace();
+    testBatchedLookups();
+    testNodes();
+    testMerge();
+    testEraseIf();
+    testSetOperations();
+    testMixedHash();
+    testStoredHash();
+    testPoolAllocator();
+    testInlineBuckets();
+    testPooledResize();
+    testParallelRangeConstructor();
+    testPooledCloneAndEquals();
+    testBucketIndexWhileRehashing();
+    testReserveFloor();
+    testIncrementalRehashBound();
+    testRandomIncrementalOperations();
+    std::printf("HashMap tests passed\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include "../FlatHashMap.hpp"
+#include "../HashMap.hpp"
+#include "../RobinHoodHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * use the interface that the open-addressing maps share with HashMap, and check that it behaves as it does in
+ * HashMap.
+ * @tparam Map - the map type.
+ */
+template<typename Map>
+static void checkCoreInterface()
+{
+    Map map;
+    CHECK(map.empty() && map.size() == 0 && map.capacity() > 0);
+    for (int key = 0; key < 1000; ++key)
+    {
+        CHECK(map.insert(key, key * 2));
+    }
+    CHECK(!map.insert(7, 0) && map.at(7) == 14);
+    CHECK(map.size() == 1000 && !map.empty());
+    CHECK(map.load_factor() > 0 && map.load_factor() <= 1);
+    CHECK(map.contains_key(999) && !map.contains_key(1000));
+    map[1000] += 5;
+    map[7] = 1;
+    CHECK(map.at(1000) == 5 && map.at(7) == 1);
+    const Map& constMap = map;
+    CHECK(constMap.at(1000) == 5 && constMap[1000] == 5);
+    bool thrown = false;
+    try
+    {
+        constMap.at(-1);
+    }
+    catch (const std::out_of_range&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(map.erase(1000) && !map.erase(1000));
+    std::vector<int> keys = {1, -1, 2};
+    std::vector<bool> contained;
+    map.contains_many(keys.begin(), keys.end(), std::back_inserter(contained));
+    CHECK(contained == std::vector<bool>({true, false, true}));
+    std::vector<int> found;
+    map.at_many(keys.begin(), keys.begin() + 1, std::back_inserter(found));
+    CHECK(found == std::vector<int>({2}));
+    long sum = 0;
+    size_t visited = 0;
+    for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it)
+    {
+        sum += it->second;
+        visited++;
+    }
+    CHECK(visited == map.size() && sum == 999 * 1000 - 14 + 1);
+    Map copy(map);
+    CHECK(copy == map && !(copy != map));
+    copy.erase(0);
+    CHECK(copy != map);
+    copy = map;
+    CHECK(copy == map);
+    map.clear();
+    CHECK(map.empty() && map.begin() == map.end() && copy.size() == 1000);
+}
+
+int main()
+{
+    checkCoreInterface<HashMap<int, int>>();
+    checkCoreInterface<FlatHashMap<int, int>>();
+    checkCoreInterface<RobinHoodHashMap<int, int>>();
+    std::printf("map conformance tests passed\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../ReadMostlyHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * every value the writer stores for a key is the key plus a multiple of kStride, so a reader can tell a value of
+ * another key or a torn one.
+ */
+static const long kStride = 1000000;
+
+/**
+ * readers look keys up without a lock while one writer inserts, grows the table, assigns, erases and clears. the
+ * final contents are compared with std::unordered_map that saw the same updates.
+ */
+static void testReadersWhileWriting()
+{
+    const int numOfKeys = 20000;
+    ReadMostlyHashMap<int, long> map;
+    std::unordered_map<int, long> expected;
+    std::atomic<bool> stop(false);
+    std::atomic<bool> wrong(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&map, &stop, &wrong, t]
+        {
+            std::mt19937 random(t);
+            while (!stop.load())
+            {
+                int key = (int) (random() % numOfKeys);
+                long value = 0;
+                if (map.find(key, value) && value % kStride != key)
+                {
+                    wrong.store(true);
+                }
+                try
+                {
+                    if (map.at(key) % kStride != key)
+                    {
+                        wrong.store(true);
+                    }
+                }
+                catch (const std::out_of_range&)
+                {
+
+                }
+                map.contains_key(key);
+                map.capacity();
+            }
+        });
+    }
+    std::mt19937 random(99);
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int key = 0; key < numOfKeys; ++key)
+        {
+            CHECK(map.insert(key, key) == expected.emplace(key, key).second);
+        }
+        for (int i = 0; i < 100000; ++i)
+        {
+            int key = (int) (random() % numOfKeys);
+            long value = key + kStride * (long) (random() % 1000);
+            switch (random() % 3)
+            {
+                case 0:
+                    CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                    break;
+                case 1:
+                    CHECK(map.insert_or_assign(key, value) == (expected.count(key) == 0));
+                    expected[key] = value;
+                    break;
+                default:
+                    CHECK(map.erase(key) == (expected.erase(key) == 1));
+            }
+        }
+        if (round < 2)
+        {
+            map.clear();
+            expected.clear();
+            CHECK(map.empty());
+        }
+    }
+    stop.store(true);
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    CHECK(!wrong.load());
+    CHECK(map.size() == expected.size());
+    for (int key = 0; key < numOfKeys; ++key)
+    {
+        long value = 0;
+        CHECK(map.find(key, value) == (expected.count(key) == 1));
+        CHECK(!map.contains_key(key) || map.at(key) == expected[key]);
+    }
+}
+
+int main()
+{
+    testReadersWhileWriting();
+    std::printf("ReadMostlyHashMap tests passed\n");
+    return 0;
+}
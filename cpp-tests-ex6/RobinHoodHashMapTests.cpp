@@ -0,0 +1,166 @@
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "../RobinHoodHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * a hash that sends every key to the same home slot.
+ */
+struct SameHash
+{
+    size_t operator()(int) const
+    {
+        return 0;
+    }
+};
+
+/**
+ * a hash with few distinct codes, so runs of displaced elements are long and erase shifts them back.
+ */
+struct PoorHash
+{
+    size_t operator()(int key) const
+    {
+        return (size_t) (key % 64);
+    }
+};
+
+/**
+ * random operations compared with std::unordered_map.
+ * @tparam Map - the map type.
+ * @param numOfKeys - keys are drawn from [0, numOfKeys).
+ * @param numOfOperations - number of operations.
+ */
+template<typename Map>
+static void checkRandomOperations(int numOfKeys, int numOfOperations)
+{
+    Map map;
+    std::unordered_map<int, long> expected;
+    std::mt19937 random(13);
+    for (int i = 0; i < numOfOperations; ++i)
+    {
+        int key = (int) (random() % numOfKeys);
+        long value = (long) random();
+        switch (random() % 4)
+        {
+            case 0:
+                CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                break;
+            case 1:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            case 2:
+                map[key] += value;
+                expected[key] += value;
+                break;
+            default:
+                CHECK(map.contains_key(key) == (expected.count(key) == 1));
+                CHECK(!map.contains_key(key) || map.at(key) == expected[key]);
+        }
+    }
+    CHECK(map.size() == expected.size());
+    CHECK(map.load_factor() <= 0.9);
+    size_t visited = 0;
+    for (const pair<int, long>& element : map)
+    {
+        CHECK(expected.at(element.first) == element.second);
+        visited++;
+    }
+    CHECK(visited == expected.size());
+    Map copy(map);
+    CHECK(copy == map);
+    copy.erase(expected.begin()->first);
+    CHECK(copy != map);
+    copy = map;
+    CHECK(copy == map);
+    for (const std::pair<const int, long>& element : expected)
+    {
+        CHECK(map.erase(element.first));
+    }
+    CHECK(map.empty() && map.max_probe_distance() == 0 && map.mean_probe_distance() == 0);
+    CHECK(copy.size() == expected.size());
+}
+
+/**
+ * keys that share a home slot form one run, and erasing from it shifts the rest back instead of leaving a gap.
+ */
+static void testBackwardShift()
+{
+    RobinHoodHashMap<int, int, SameHash> map;
+    for (int key = 0; key < 10; ++key)
+    {
+        map.insert(key, key);
+    }
+    CHECK(map.max_probe_distance() == 9);
+    CHECK(map.mean_probe_distance() == 4.5);
+    CHECK(map.erase(0));
+    CHECK(map.max_probe_distance() == 8);
+    CHECK(map.erase(5));
+    CHECK(map.max_probe_distance() == 7);
+    for (int key = 1; key < 10; ++key)
+    {
+        CHECK(map.contains_key(key) == (key != 5));
+    }
+}
+
+/**
+ * the batched lookups, the range constructor, and the rejection of an invalid maximum load.
+ */
+static void testBatchedLookups()
+{
+    std::vector<int> keys;
+    std::vector<long> values;
+    for (int key = 0; key < 5000; ++key)
+    {
+        keys.push_back(key * 2);
+        values.push_back(key * 7);
+    }
+    RobinHoodHashMap<int, long> map(keys.begin(), keys.end(), values.begin(), values.end());
+    std::vector<int> queries;
+    for (int key = 0; key < 10000; ++key)
+    {
+        queries.push_back(key);
+    }
+    std::vector<bool> contained;
+    map.contains_many(queries.begin(), queries.end(), std::back_inserter(contained));
+    for (int key = 0; key < 10000; ++key)
+    {
+        CHECK(contained[key] == (key % 2 == 0));
+    }
+    std::vector<long> found;
+    map.at_many(keys.begin(), keys.end(), std::back_inserter(found));
+    CHECK(found == values);
+    bool thrown = false;
+    try
+    {
+        map.at_many(queries.begin(), queries.end(), std::back_inserter(found));
+    }
+    catch (const std::out_of_range&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    thrown = false;
+    try
+    {
+        RobinHoodHashMap<int, long> invalid(1.0);
+    }
+    catch (const std::invalid_argument&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main()
+{
+    checkRandomOperations<RobinHoodHashMap<int, long>>(20000, 300000);
+    checkRandomOperations<RobinHoodHashMap<int, long, PoorHash>>(2000, 50000);
+    testBackwardShift();
+    testBatchedLookups();
+    std::printf("RobinHoodHashMap tests passed\n");
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../SeqlockHashMap.hpp"
+#include "TestUtils.hpp"
+
+struct Record
+{
+    long a;
+    long b;
+    char c[5];
+};
+
+static Record makeRecord(long a)
+{
+    return Record{a, a * 3, {0, 0, 0, 0, (char) a}};
+}
+
+/**
+ * random operations compared with std::unordered_map, while readers check that they never see a torn value.
+ */
+static void testRandomOperations()
+{
+    SeqlockHashMap<int, Record> map(4);
+    std::atomic<bool> stop(false);
+    std::atomic<bool> torn(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t)
+    {
+        readers.emplace_back([&map, &stop, &torn]
+        {
+            while (!stop.load())
+            {
+                for (int key = 0; key < 2000; ++key)
+                {
+                    Record record;
+                    if (map.find(key, record) && (record.b != record.a * 3 || record.c[4] != (char) record.a))
+                    {
+                        torn.store(true);
+                    }
+                }
+            }
+        });
+    }
+    std::mt19937 random(1);
+    std::unordered_map<int, long> expected;
+    for (int i = 0; i < 200000; ++i)
+    {
+        int key = (int) (random() % 2000);
+        long a = (long) (random() % 1000);
+        switch (random() % 4)
+        {
+            case 0:
+                CHECK(map.insert(key, makeRecord(a)) == expected.emplace(key, a).second);
+                break;
+            case 1:
+                CHECK(map.insert_or_assign(key, makeRecord(a)) == (expected.count(key) == 0));
+                expected[key] = a;
+                break;
+            case 2:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            default:
+            {
+                Record record;
+                bool found = map.find(key, record);
+                CHECK(found == (expected.count(key) == 1));
+                CHECK(!found || record.a == expected[key]);
+            }
+        }
+    }
+    stop.store(true);
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    CHECK(!torn.load());
+    CHECK(map.size() == expected.size());
+}
+
+/**
+ * concurrent updates of the same keys are not lost.
+ */
+static void testConcurrentUpdates()
+{
+    SeqlockHashMap<long, long> counters;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+    {
+        writers.emplace_back([&counters]
+        {
+            for (int i = 0; i < 10000; ++i)
+            {
+                counters.update(i % 100, [](long& value)
+                {
+                    value++;
+                });
+            }
+        });
+    }
+    for (std::thread& writer : writers)
+    {
+        writer.join();
+    }
+    for (long key = 0; key < 100; ++key)
+    {
+        CHECK(counters.at(key) == 400);
+    }
+    bool thrown = false;
+    try
+    {
+        counters.at(1000);
+    }
+    catch (const std::out_of_range&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * an update function that throws leaves the map unchanged and readable.
+ */
+static void testThrowingUpdate()
+{
+    SeqlockHashMap<int, int> map(1);
+    map.insert(1, 5);
+    for (int key : {1, 2})
+    {
+        bool thrown = false;
+        try
+        {
+            map.update(key, [](int&)
+            {
+                throw std::runtime_error("update failed");
+            });
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    int value = 0;
+    CHECK(map.find(1, value) && value == 5);
+    CHECK(!map.contains_key(2));
+    CHECK(map.size() == 1);
+    CHECK(map.update(1, [](int& v)
+    {
+        v++;
+    }) == 6);
+}
+
+int main()
+{
+    testThrowingUpdate();
+    testRandomOperations();
+    testConcurrentUpdates();
+    std::printf("SeqlockHashMap tests passed\n");
+    return 0;
+}
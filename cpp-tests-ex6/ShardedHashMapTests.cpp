@@ -0,0 +1,117 @@
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include "../ShardedHashMap.hpp"
+#include "TestUtils.hpp"
+
+typedef ShardedHashMap<int, long> Sharded;
+typedef Sharded::Shard Shard;
+
+/**
+ * check that a merged map holds exactly the expected elements, each once.
+ */
+static void checkEqual(const Shard& target, const std::unordered_map<int, long>& expected)
+{
+    CHECK(target.size() == expected.size());
+    std::unordered_set<int> seen;
+    size_t iterated = 0;
+    for (const pair<int, long>& element : target)
+    {
+        iterated++;
+        CHECK(seen.insert(element.first).second);
+        auto it = expected.find(element.first);
+        CHECK(it != expected.end() && it->second == element.second);
+    }
+    CHECK(iterated == expected.size());
+    for (const auto& element : expected)
+    {
+        CHECK(target.contains_key(element.first) && target.at(element.first) == element.second);
+    }
+}
+
+/**
+ * a target with incremental rehash on that already holds some of the keys must not end up with duplicates.
+ */
+static void testIncrementalTarget()
+{
+    Sharded sharded(1);
+    for (int i = 0; i < 40; ++i)
+    {
+        sharded.shard(0).insert(i, 1);
+    }
+    Shard target;
+    target.set_incremental_rehash(1);
+    std::unordered_map<int, long> expected;
+    for (int i = 0; i < 12; ++i)
+    {
+        target.insert(i, 1);
+    }
+    for (int i = 0; i < 40; ++i)
+    {
+        expected[i] = i < 12 ? 2 : 1;
+    }
+    sharded.merge_into(target, [](long& value, const long& added)
+    {
+        value += added;
+    });
+    checkEqual(target, expected);
+}
+
+/**
+ * merge random shards into random targets and compare the result with std::unordered_map.
+ */
+static void testRandomMerges(ThreadPool* pool)
+{
+    std::mt19937 random(7);
+    for (int round = 0; round < 60; ++round)
+    {
+        size_t numOfShards = 1 + random() % 4;
+        Sharded sharded(numOfShards);
+        std::unordered_map<int, long> expected;
+        int keyRange = 1 + (int) (random() % 50000);
+        for (size_t s = 0; s < numOfShards; ++s)
+        {
+            size_t count = random() % 30000;
+            for (size_t i = 0; i < count; ++i)
+            {
+                int key = (int) (random() % keyRange);
+                if (sharded.shard(s).insert(key, key))
+                {
+                    expected[key] += key;
+                }
+            }
+        }
+        Shard target;
+        if (round % 3 == 0)
+        {
+            target.set_incremental_rehash(1 + random() % 4);
+        }
+        if (round % 4 == 1)
+        {
+            target.reserve(100000);
+        }
+        size_t initial = round % 2 == 0 ? random() % 2000 : 0;
+        for (size_t i = 0; i < initial; ++i)
+        {
+            int key = (int) (random() % keyRange);
+            if (target.insert(key, 1))
+            {
+                expected[key] += 1;
+            }
+        }
+        sharded.merge_into(target, [](long& value, const long& added)
+        {
+            value += added;
+        }, round % 2 == 0 ? pool : nullptr);
+        checkEqual(target, expected);
+    }
+}
+
+int main()
+{
+    ThreadPool pool(3);
+    testIncrementalTarget();
+    testRandomMerges(&pool);
+    std::printf("ShardedHashMap tests passed\n");
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../SplitOrderedHashMap.hpp"
+#include "TestUtils.hpp"
+
+/**
+ * random operations on one thread compared with std::unordered_map, across many bucket splits.
+ */
+static void testRandomOperations()
+{
+    SplitOrderedHashMap<int, long> map;
+    std::unordered_map<int, long> expected;
+    std::mt19937 random(3);
+    for (int i = 0; i < 200000; ++i)
+    {
+        int key = (int) (random() % 20000) - 10000;
+        long value = (long) random();
+        switch (random() % 3)
+        {
+            case 0:
+                CHECK(map.insert(key, value) == expected.emplace(key, value).second);
+                break;
+            case 1:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            default:
+            {
+                long found = 0;
+                bool contained = map.find(key, found);
+                CHECK(contained == (expected.count(key) == 1));
+                CHECK(!contained || found == expected[key]);
+                CHECK(map.contains_key(key) == contained);
+            }
+        }
+    }
+    CHECK(map.size() == expected.size());
+    size_t visited = 0;
+    map.for_each([&expected, &visited](const pair<int, long>& element)
+    {
+        CHECK(expected.at(element.first) == element.second);
+        visited++;
+    });
+    CHECK(visited == expected.size());
+    bool thrown = false;
+    try
+    {
+        map.at(20000);
+    }
+    catch (const std::out_of_range&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * threads insert and erase disjoint keys while contending on a shared range.
+ */
+static void testConcurrentOperations()
+{
+    SplitOrderedHashMap<int, long> map;
+    const int numOfThreads = 4;
+    const int perThread = 50000;
+    std::atomic<bool> failed(false);
+    std::atomic<int> balance(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numOfThreads; ++t)
+    {
+        threads.emplace_back([&map, &failed, t]
+        {
+            for (int i = 0; i < perThread; ++i)
+            {
+                int key = i * numOfThreads + t;
+                if (!map.insert(key, key * 2L) || map.insert(key, 0) || (i % 2 == 0 && !map.erase(key)))
+                {
+                    failed.store(true);
+                }
+            }
+            for (int i = 0; i < perThread; ++i)
+            {
+                int key = i * numOfThreads + t;
+                long value = 0;
+                if (map.find(key, value) != (i % 2 == 1) || (i % 2 == 1 && value != key * 2L))
+                {
+                    failed.store(true);
+                }
+            }
+        });
+        threads.emplace_back([&map, &balance]
+        {
+            for (int key = -1; key > -2000; --key)
+            {
+                if (map.insert(key, 1))
+                {
+                    balance++;
+                }
+                if (map.erase(key))
+                {
+                    balance--;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(!failed.load());
+    CHECK(balance.load() == 0);
+    CHECK(map.size() == (size_t) numOfThreads * perThread / 2);
+}
+
+int main()
+{
+    testRandomOperations();
+    testConcurrentOperations();
+    std::printf("SplitOrderedHashMap tests passed\n");
+    return 0;
+}
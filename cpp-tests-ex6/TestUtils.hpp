@@ -0,0 +1,20 @@
+#ifndef SUMMEREX6_TESTUTILS_HPP
+#define SUMMEREX6_TESTUTILS_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * fail the test with the location of the check if a condition does not hold. unlike assert it is never compiled out.
+ */
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1); \
+        } \
+    } while (0)
+
+#endif //SUMMEREX6_TESTUTILS_HPP